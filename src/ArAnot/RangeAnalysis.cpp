@@ -12,6 +12,12 @@
 
 #include "RangeAnalysis.h"
 #include "llvm/Support/InstIterator.h"
+#include "llvm/Assembly/Writer.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/OwningPtr.h"
+#include <pthread.h>
 
 using namespace llvm;
 
@@ -34,6 +40,27 @@ STATISTIC(numZeroUses, "Number of variables without any use.");
 STATISTIC(numNotInt, "Number of variables that are not Integer.");
 STATISTIC(numOps, "Number of operations");
 STATISTIC(maxVisit, "Max number of times a value has been visited.");
+STATISTIC(numCachedFunctions, "Number of functions whose ranges came from the cache.");
+
+static cl::opt<unsigned> raThreads("raThreads",
+		cl::desc("Number of threads used to solve independent SCCs of the constraint graph."),
+		cl::init(1));
+
+static cl::opt<bool> raDemand("raDemand",
+		cl::desc("Solve the inter-procedural constraint graph only for the values whose ranges are asked for."),
+		cl::init(false));
+
+static cl::opt<bool> raCache("raCache",
+		cl::desc("Reuse the intra-procedural ranges of functions that have already been solved."),
+		cl::init(false));
+
+static cl::opt<std::string> raCacheFile("raCacheFile",
+		cl::desc("File that keeps the range cache between runs (implies -raCache)."),
+		cl::init(""));
+
+static cl::opt<std::string> raProfile("raProfile",
+		cl::desc("Write the time, counters and memory of each phase of the range analysis to this file as JSON (- for stderr)."),
+		cl::init(""));
 
 // The number of bits needed to store the largest variable of the function (APInt).
 unsigned MAX_BIT_INT = 1;
@@ -51,6 +78,8 @@ DenseMap<const Value*, unsigned> FerMap;
 APInt Min = APInt::getSignedMinValue(MAX_BIT_INT);
 APInt Max = APInt::getSignedMaxValue(MAX_BIT_INT);
 APInt Zero(MAX_BIT_INT, 0, true);
+int64_t MinWord = Min.getSExtValue();
+int64_t MaxWord = Max.getSExtValue();
 
 // String used to identify sigmas
 const std::string sigmaString = "sigma_node";
@@ -59,10 +88,116 @@ const std::string sigmaString = "sigma_node";
 std::string pestring;
 raw_string_ostream pseudoEdgesString(pestring);
 
+// Used to profile: the profile of the analysis that is running, set by its
+// entry points (runOnFunction, runOnModule, query and update)
+Profile *prof = NULL;
+
+// The phases are timed with STATS or -raProfile; when they are, the SCCs are
+// solved by a single thread.
+static bool profiling() {
 #ifdef STATS
-// Used to profile
-Profile prof;
+	return true;
+#else
+	return !raProfile.empty();
 #endif
+}
+
+// Prints S as a quoted JSON string
+static void printJSONString(raw_ostream &OS, StringRef S) {
+	OS << '"';
+	for (StringRef::iterator it = S.begin(), end = S.end(); it != end; ++it) {
+		unsigned char c = *it;
+		if (c == '"' || c == '\\') {
+			OS << '\\' << c;
+		} else if (c < 0x20) {
+			OS << "\\u00";
+			OS.write_hex(c >> 4);
+			OS.write_hex(c & 0xF);
+		} else {
+			OS << c;
+		}
+	}
+	OS << '"';
+}
+
+// Prints the entries of a StringMap sorted by key, so that two profiles diff well
+template<class T>
+static void printJSONMap(raw_ostream &OS, const StringMap<T> &map,
+		double (*value)(const T&)) {
+	std::vector<StringRef> keys;
+	for (typename StringMap<T>::const_iterator it = map.begin(), end =
+			map.end(); it != end; ++it) {
+		keys.push_back(it->getKey());
+	}
+	std::sort(keys.begin(), keys.end());
+
+	OS << "{";
+	for (unsigned i = 0, e = keys.size(); i < e; ++i) {
+		OS << (i ? ",\n    " : "\n    ");
+		printJSONString(OS, keys[i]);
+		std::ostringstream formatted;
+		formatted << value(map.find(keys[i])->getValue());
+		OS << ": " << formatted.str();
+	}
+	OS << (keys.empty() ? "}" : "\n  }");
+}
+
+static double timeSeconds(const Profile::TimeValue &time) {
+	return time.seconds() + (0.000000001) * time.nanoseconds();
+}
+
+static double countValue(const uint64_t &count) {
+	return count;
+}
+
+void Profile::printJSON(raw_ostream &OS, StringRef module, StringRef analysis) {
+	OS << "{\n  \"module\": ";
+	printJSONString(OS, module);
+	OS << ",\n  \"analysis\": ";
+	printJSONString(OS, analysis);
+	OS << ",\n  \"times\": ";
+	printJSONMap(OS, accumulatedtimes, timeSeconds);
+	OS << ",\n  \"counters\": ";
+	printJSONMap(OS, counters, countValue);
+	OS << ",\n  \"maxima\": ";
+	printJSONMap(OS, maxima, countValue);
+	OS << ",\n  \"memoryKB\": " << memory / 1024 << "\n}\n";
+}
+
+/*
+ *	Writes the profile of an analysis of M (e.g. intra-cousot) to the file
+ *	given by -raProfile, with the name of the analysis before its extension:
+ *	-raProfile=ra.json writes ra.intra-cousot.json. Each analysis run in
+ *	the same opt gets its own file, and - prints them all to stderr.
+ */
+static void writeProfile(const Module &M, Profile &profile,
+		const std::string &analysis) {
+	if (raProfile.empty())
+		return;
+
+	if (raProfile == "-") {
+		profile.printJSON(errs(), M.getModuleIdentifier(), analysis);
+		return;
+	}
+
+	std::string fileName = raProfile;
+	size_t dot = fileName.rfind('.');
+	if (dot == std::string::npos || dot == 0
+			|| fileName.find('/', dot) != std::string::npos) {
+		fileName += "." + analysis;
+	} else {
+		fileName.insert(dot, "." + analysis);
+	}
+
+	std::string ErrorInfo;
+	raw_fd_ostream file(fileName.c_str(), ErrorInfo);
+	if (!ErrorInfo.empty()) {
+		errs() << "[RangeAnalysis] Could not write " << fileName << ": "
+				<< ErrorInfo << "\n";
+		return;
+	}
+	profile.printJSON(file, M.getModuleIdentifier(), analysis);
+}
 
 // Print name of variable according to its type
 static void printVarName(const Value *V, raw_ostream& OS) {
@@ -145,12 +280,336 @@ void RangeAnalysis::updateMinMax(unsigned maxBitWidth) {
 	Min = APInt::getSignedMinValue(maxBitWidth);
 	Max = APInt::getSignedMaxValue(maxBitWidth);
 	Zero = APInt(MAX_BIT_INT, 0, true);
+
+	if (maxBitWidth <= 64) {
+		MinWord = Min.getSExtValue();
+		MaxWord = Max.getSExtValue();
+	}
 }
 
 //unsigned RangeAnalysis::getBitWidth() {
 //	return MAX_BIT_INT;
 //}
 
+// ========================================================================== //
+// Range cache
+// ========================================================================== //
+
+// The intra-procedural ranges of a function do not depend on anything but
+// its body and the solver: calls are not followed, so their results are
+// [-inf, +inf]. The cache is keyed by a hash of the solver name and the
+// printed function, and lists the range of each argument and instruction by
+// its position in the function.
+struct CachedRange {
+	unsigned index;
+	unsigned type;
+	APInt lower, upper;
+};
+
+struct CachedFunction {
+	unsigned width;
+	std::vector<CachedRange> ranges;
+};
+
+static std::map<uint64_t, CachedFunction> rangeCache;
+static bool rangeCacheLoaded = false;
+
+static bool useRangeCache() {
+	return raCache || !raCacheFile.empty();
+}
+
+// The arguments and the instructions of F, in the order used by the cache
+static void numberValues(const Function &F, std::vector<const Value*> &values) {
+	for (Function::const_arg_iterator ait = F.arg_begin(), aend = F.arg_end();
+			ait != aend; ++ait) {
+		values.push_back(ait);
+	}
+	for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+		values.push_back(&*I);
+	}
+}
+
+// FNV-1a, one step per byte
+static void hashBytes(uint64_t &hash, const char *bytes, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char) bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+static void hashNumber(uint64_t &hash, uint64_t n) {
+	for (unsigned i = 0; i < 8; ++i, n >>= 8) {
+		char byte = n & 0xff;
+		hashBytes(hash, &byte, 1);
+	}
+}
+
+static void hashText(uint64_t &hash, StringRef text) {
+	hashNumber(hash, text.size());
+	hashBytes(hash, text.data(), text.size());
+}
+
+static void hashType(uint64_t &hash, Type *type) {
+	std::string text;
+	raw_string_ostream OS(text);
+	type->print(OS);
+	hashText(hash, OS.str());
+}
+
+/*
+ * FNV-1a hash of the solver name and of F in a canonical form: the types of
+ * its arguments and, for each instruction, its opcode, type, predicate and
+ * operands. Arguments, instructions and blocks are operands by their
+ * position in F, and constants and globals by their text. Names and
+ * metadata are left out, since they do not change the ranges, except for
+ * the prefix that marks the sigmas of vSSA.
+ */
+static uint64_t hashFunction(const Function &F, const char *solver) {
+	uint64_t hash = 14695981039346656037ULL;
+	hashText(hash, solver);
+
+	std::vector<const Value*> values;
+	numberValues(F, values);
+	DenseMap<const Value*, unsigned> numbers;
+	for (unsigned i = 0, e = values.size(); i < e; ++i) {
+		numbers[values[i]] = i;
+	}
+	unsigned nBlocks = 0;
+	for (Function::const_iterator bb = F.begin(), bbend = F.end(); bb != bbend;
+			++bb) {
+		numbers[bb] = nBlocks++;
+	}
+
+	hashType(hash, F.getReturnType());
+	hashNumber(hash, F.arg_size());
+	for (Function::const_arg_iterator ait = F.arg_begin(), aend = F.arg_end();
+			ait != aend; ++ait) {
+		hashType(hash, ait->getType());
+	}
+
+	for (Function::const_iterator bb = F.begin(), bbend = F.end(); bb != bbend;
+			++bb) {
+		hashNumber(hash, bb->size());
+
+		for (BasicBlock::const_iterator I = bb->begin(), E = bb->end(); I != E;
+				++I) {
+			hashNumber(hash, I->getOpcode());
+			hashType(hash, I->getType());
+			hashNumber(hash, I->getName().startswith(sigmaString));
+			if (const CmpInst *cmp = dyn_cast<CmpInst>(I)) {
+				hashNumber(hash, cmp->getPredicate());
+			}
+
+			hashNumber(hash, I->getNumOperands());
+			for (User::const_op_iterator oit = I->op_begin(), oend =
+					I->op_end(); oit != oend; ++oit) {
+				const Value *operand = *oit;
+
+				DenseMap<const Value*, unsigned>::iterator nit =
+						numbers.find(operand);
+				if (nit != numbers.end()) {
+					hashNumber(hash, isa<BasicBlock>(operand) ? 1 : 0);
+					hashNumber(hash, nit->second);
+				} else if (isa<MDNode>(operand) || isa<MDString>(operand)) {
+					hashNumber(hash, 2);
+				} else {
+					std::string text;
+					raw_string_ostream OS(text);
+					WriteAsOperand(OS, operand, true, F.getParent());
+					hashNumber(hash, 3);
+					hashText(hash, OS.str());
+				}
+			}
+
+			// The blocks of a phi are not among its operands
+			if (const PHINode *phi = dyn_cast<PHINode>(I)) {
+				for (unsigned i = 0, e = phi->getNumIncomingValues(); i < e; ++i) {
+					hashNumber(hash, numbers[phi->getIncomingBlock(i)]);
+				}
+			}
+		}
+	}
+
+	return hash;
+}
+
+// Parses a signed decimal that fits in width bits
+static bool parseBound(StringRef text, unsigned width, APInt &result) {
+	bool negative = text.startswith("-");
+	if (negative)
+		text = text.substr(1);
+
+	APInt magnitude;
+	if (text.getAsInteger(10, magnitude) || magnitude.getActiveBits() > width)
+		return false;
+
+	result = magnitude.zextOrTrunc(width);
+	if (!negative)
+		return !result.isNegative();
+
+	// Only Min keeps its sign bit when negated
+	result = -result;
+	return result.isNegative() || !result;
+}
+
+/*
+ * The cache file has one block per function:
+ *
+ *     function <hash in hex> <bit width> <number of ranges>
+ *     <index> <type> <lower> <upper>
+ *     ...
+ */
+static void loadRangeCache() {
+	rangeCacheLoaded = true;
+	if (raCacheFile.empty())
+		return;
+
+	OwningPtr<MemoryBuffer> buffer;
+	if (MemoryBuffer::getFile(raCacheFile, buffer))
+		return; // Nothing cached yet
+
+	StringRef text = buffer->getBuffer();
+	while (!text.empty()) {
+		std::pair<StringRef, StringRef> line = text.split('\n');
+		text = line.second;
+		if (line.first.empty())
+			continue;
+
+		SmallVector<StringRef, 4> fields;
+		line.first.split(fields, " ");
+		uint64_t hash;
+		unsigned count;
+		CachedFunction entry;
+		bool valid = true;
+		if (fields.size() != 4 || fields[0] != "function"
+				|| fields[1].getAsInteger(16, hash)
+				|| fields[2].getAsInteger(10, entry.width)
+				|| fields[3].getAsInteger(10, count) || entry.width == 0) {
+			errs() << "[RangeAnalysis] " << raCacheFile
+					<< ": malformed entry: " << line.first << "\n";
+			return;
+		}
+
+		for (unsigned i = 0; i < count; ++i) {
+			line = text.split('\n');
+			text = line.second;
+			fields.clear();
+			line.first.split(fields, " ");
+
+			CachedRange range;
+			if (fields.size() != 4 || fields[0].getAsInteger(10, range.index)
+					|| fields[1].getAsInteger(10, range.type)
+					|| range.type > Empty) {
+				errs() << "[RangeAnalysis] " << raCacheFile
+						<< ": malformed range: " << line.first << "\n";
+				return;
+			}
+
+			// A bound that does not fit the width drops the whole function
+			if (!parseBound(fields[2], entry.width, range.lower)
+					|| !parseBound(fields[3], entry.width, range.upper)) {
+				if (valid)
+					errs() << "[RangeAnalysis] " << raCacheFile
+							<< ": bad bound, entry dropped: " << line.first
+							<< "\n";
+				valid = false;
+			}
+			entry.ranges.push_back(range);
+		}
+
+		if (valid)
+			rangeCache[hash] = entry;
+	}
+}
+
+static void saveRangeCache() {
+	if (raCacheFile.empty())
+		return;
+
+	std::string ErrorInfo;
+	raw_fd_ostream file(raCacheFile.c_str(), ErrorInfo);
+	if (!ErrorInfo.empty()) {
+		errs() << "[RangeAnalysis] Could not write " << raCacheFile << ": "
+				<< ErrorInfo << "\n";
+		return;
+	}
+
+	for (std::map<uint64_t, CachedFunction>::iterator fit = rangeCache.begin(),
+			fend = rangeCache.end(); fit != fend; ++fit) {
+		const CachedFunction &entry = fit->second;
+		file << "function ";
+		file.write_hex(fit->first);
+		file << " " << entry.width << " " << entry.ranges.size() << "\n";
+
+		for (std::vector<CachedRange>::const_iterator rit = entry.ranges.begin(),
+				rend = entry.ranges.end(); rit != rend; ++rit) {
+			file << rit->index << " " << rit->type << " "
+					<< rit->lower.toString(10, true) << " "
+					<< rit->upper.toString(10, true) << "\n";
+		}
+	}
+}
+
+// Records the ranges that CG found for F
+static void storeRanges(uint64_t hash, const Function &F, ConstraintGraph &CG) {
+	std::vector<const Value*> values;
+	numberValues(F, values);
+
+	CachedFunction &entry = rangeCache[hash];
+	entry.width = MAX_BIT_INT;
+	entry.ranges.clear();
+
+	VarNodes *vars = CG.getVars();
+	for (unsigned i = 0, e = values.size(); i < e; ++i) {
+		VarNodes::iterator vit = vars->find(values[i]);
+		if (vit == vars->end())
+			continue;
+
+		Range R = vit->second->getRange();
+		CachedRange range;
+		range.index = i;
+		range.type = R.isUnknown() ? Unknown : (R.isEmpty() ? Empty : Regular);
+		range.lower = R.getLower();
+		range.upper = R.getUpper();
+		entry.ranges.push_back(range);
+	}
+}
+
+// Fills CG with the cached ranges of F. Returns false if F is not cached.
+static bool restoreRanges(uint64_t hash, const Function &F, ConstraintGraph &CG) {
+	std::map<uint64_t, CachedFunction>::iterator fit = rangeCache.find(hash);
+	if (fit == rangeCache.end() || fit->second.width != MAX_BIT_INT)
+		return false;
+
+	std::vector<const Value*> values;
+	numberValues(F, values);
+
+	const std::vector<CachedRange> &ranges = fit->second.ranges;
+	for (std::vector<CachedRange>::const_iterator rit = ranges.begin(), rend =
+			ranges.end(); rit != rend; ++rit) {
+		if (rit->index >= values.size())
+			return false;
+	}
+
+	for (std::vector<CachedRange>::const_iterator rit = ranges.begin(), rend =
+			ranges.end(); rit != rend; ++rit) {
+		VarNode *node = CG.addVarNode(values[rit->index]);
+		node->setRange(Range(rit->lower, rit->upper, (RangeType) rit->type));
+	}
+
+	// Constants are not cached: their ranges are the constants themselves
+	for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+		for (User::const_op_iterator oit = I->op_begin(), oend = I->op_end();
+				oit != oend; ++oit) {
+			const Value *op = *oit;
+			if (isa<ConstantInt>(op) && !CG.getVars()->count(op))
+				CG.addVarNode(op)->init(true);
+		}
+	}
+
+	return true;
+}
+
 // ========================================================================== //
 // IntraProceduralRangeAnalysis
 // ========================================================================== //
@@ -175,22 +634,37 @@ template<class CGT>
 bool IntraProceduralRA<CGT>::runOnFunction(Function &F) {
 //	if(CG) delete CG;
 	CG = new CGT();
+	prof = &profile;
 
 	MAX_BIT_INT = getMaxBitWidth(F);
 	updateMinMax(MAX_BIT_INT);
 
+	// Reuse the ranges of an identical function solved before
+	uint64_t hash = 0;
+	if (useRangeCache()) {
+		if (!rangeCacheLoaded)
+			loadRangeCache();
+
+		hash = hashFunction(F, CG->getSolverName());
+		if (restoreRanges(hash, F, *CG)) {
+			++numCachedFunctions;
+			if (profiling())
+				prof->addCount("CachedFunctions", 1);
+			return false;
+		}
+	}
+
 	// Build the graph and find the intervals of the variables.
-#ifdef STATS
-	Profile::TimeValue before = prof.timenow();
-#endif
+	Profile::TimeValue before;
+	if (profiling())
+		before = prof->timenow();
 	CG->buildGraph(F);
 	CG->buildVarNodes();
-#ifdef STATS
-	Profile::TimeValue elapsed = prof.timenow() - before;
-	prof.updateTime("BuildGraph", elapsed);
-
-	prof.setMemoryUsage();
-#endif
+	if (profiling()) {
+		prof->updateTime("BuildGraph", prof->timenow() - before);
+		prof->addCount("Functions", 1);
+		prof->setMemoryUsage();
+	}
 #ifdef PRINT_DEBUG
 	CG->printToFile(F, "/tmp/" + F.getName() + "cgpre.dot");
 	errs() << "Analyzing function " << F.getName() << ":\n";
@@ -199,18 +673,33 @@ bool IntraProceduralRA<CGT>::runOnFunction(Function &F) {
 #ifdef PRINT_DEBUG
 	CG->printToFile(F, "/tmp/" + F.getName() + "cgpos.dot");
 #endif
+	if (profiling())
+		prof->setMemoryUsage();
+
+	if (useRangeCache())
+		storeRanges(hash, F, *CG);
 
 	return false;
 }
 
+template<class CGT>
+bool IntraProceduralRA<CGT>::doFinalization(Module &M) {
+	if (useRangeCache())
+		saveRangeCache();
+	// CG is only NULL if no function was analyzed
+	if (CG)
+		writeProfile(M, profile, std::string("intra-") + CG->getSolverName());
+	return false;
+}
+
 template <class CGT>
 IntraProceduralRA<CGT>::~IntraProceduralRA(){
 #ifdef STATS
-	prof.printTime("BuildGraph");
-	prof.printTime("Nuutila");
-	prof.printTime("SCCs resolution");
-	prof.printTime("ComputeStats");
-	prof.printMemoryUsage();
+	profile.printTime("BuildGraph");
+	profile.printTime("Nuutila");
+	profile.printTime("SCCs resolution");
+	profile.printTime("ComputeStats");
+	profile.printMemoryUsage();
 	
 	std::ostringstream formated;
 	formated << 100 * (1.0 - ((double)(needBits) / usedBits));
@@ -256,9 +745,194 @@ APInt InterProceduralRA<CGT>::getMax()
 
 template <class CGT>
 Range InterProceduralRA<CGT>::getRange(const Value *v){
+	if (raDemand && !slice.count(v)) {
+		SmallVector<const Value*, 1> values(1, v);
+		query(values);
+	}
 	return CG->getRange(v);
 }
 
+/*
+ *	Adds to slice the values that the ranges of queries depend on: the
+ *	operands of the instructions modeled by the constraint graph, the
+ *	operands of the comparisons that create sigmas, the real parameters of
+ *	formal parameters and the return values of calls. The walk stops at the
+ *	values already in slice, since their dependences are there too. sliced
+ *	receives the values new to the slice, and functions the functions not
+ *	in seen yet that these values belong to, or whose return values they
+ *	receive.
+ */
+static void buildBackwardSlice(const SmallVectorImpl<const Value*> &queries,
+		ValueSlice &slice, std::vector<const Value*> &sliced,
+		SmallPtrSet<Function*, 16> &seen, std::vector<Function*> &functions) {
+	std::vector<const Value*> worklist(queries.begin(), queries.end());
+
+	while (!worklist.empty()) {
+		const Value *V = worklist.back();
+		worklist.pop_back();
+		if (!slice.insert(V))
+			continue;
+		sliced.push_back(V);
+
+		Function *F = NULL;
+		if (const Argument *A = dyn_cast<Argument>(V)) {
+			F = const_cast<Function*>(A->getParent());
+
+			// The real parameters of every call site
+			for (Value::use_iterator UI = F->use_begin(), E = F->use_end();
+					UI != E; ++UI) {
+				if (!isa<CallInst>(*UI) && !isa<InvokeInst>(*UI))
+					continue;
+
+				CallSite CS(cast<Instruction>(*UI));
+				if (CS.isCallee(UI) && A->getArgNo() < CS.arg_size())
+					worklist.push_back(CS.getArgument(A->getArgNo()));
+			}
+		} else if (const Instruction *I = dyn_cast<Instruction>(V)) {
+			F = const_cast<Function*>(I->getParent()->getParent());
+
+			if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+				// The return values of the callee
+				CallSite CS(const_cast<Instruction*>(I));
+				Function *callee = CS.getCalledFunction();
+				if (callee && !callee->isDeclaration() && !callee->isVarArg()) {
+					if (seen.insert(callee))
+						functions.push_back(callee);
+					for (Function::iterator bb = callee->begin(), bbend =
+							callee->end(); bb != bbend; ++bb) {
+						if (ReturnInst *RI = dyn_cast<ReturnInst>(bb->getTerminator()))
+							if (RI->getReturnValue())
+								worklist.push_back(RI->getReturnValue());
+					}
+				}
+			} else if (isValidInstruction(I)) {
+				worklist.insert(worklist.end(), I->op_begin(), I->op_end());
+
+				// The comparison that gives a sigma its interval
+				if (I->getName().startswith(sigmaString)) {
+					const BasicBlock *pred = I->getParent()->getSinglePredecessor();
+					const TerminatorInst *ti = pred ? pred->getTerminator() : NULL;
+					const BranchInst *br = dyn_cast_or_null<BranchInst>(ti);
+					const SwitchInst *sw = dyn_cast_or_null<SwitchInst>(ti);
+
+					if (br && br->isConditional()) {
+						if (const ICmpInst *ici = dyn_cast<ICmpInst>(br->getCondition()))
+							worklist.insert(worklist.end(), ici->op_begin(), ici->op_end());
+					} else if (sw) {
+						worklist.push_back(sw->getCondition());
+					}
+				}
+			}
+		}
+
+		if (F && seen.insert(F))
+			functions.push_back(F);
+	}
+}
+
+template<class CGT>
+void InterProceduralRA<CGT>::query(const SmallVectorImpl<const Value*> &values) {
+	// Other range analyses may have run since runOnModule
+	MAX_BIT_INT = width;
+	updateMinMax(MAX_BIT_INT);
+	prof = &profile;
+
+	bool extend = !slice.empty();
+	std::vector<const Value*> sliced;
+	std::vector<Function*> functions;
+	buildBackwardSlice(values, slice, sliced, sliceFunctions, functions);
+	if (sliced.empty())
+		return;
+
+	Profile::TimeValue before;
+	if (profiling()) {
+		before = prof->timenow();
+		prof->addCount("Queries", 1);
+	}
+
+	if (!extend) {
+		for (std::vector<Function*>::iterator fit = functions.begin(), fend =
+				functions.end(); fit != fend; ++fit) {
+			if ((*fit)->isDeclaration() || (*fit)->isVarArg())
+				continue;
+
+			CG->buildGraph(**fit, &slice);
+			MatchParametersAndReturnValues(**fit, *CG);
+		}
+		CG->buildVarNodes();
+		if (profiling()) {
+			prof->updateTime("BuildGraph", prof->timenow() - before);
+			prof->setMemoryUsage();
+		}
+		CG->findIntervals();
+		if (profiling())
+			prof->setMemoryUsage();
+		return;
+	}
+
+	// The graph already holds the earlier slices: add the new values to it
+	// and solve again only the SCCs they reach
+	for (std::vector<Function*>::iterator fit = functions.begin(), fend =
+			functions.end(); fit != fend; ++fit) {
+		Function *F = *fit;
+		if (F->isDeclaration() || F->isVarArg())
+			continue;
+
+		MatchParametersAndReturnValues(*F, *CG);
+
+		// Its formal parameters and call sites were inputs up to now
+		for (Function::arg_iterator ait = F->arg_begin(), aend = F->arg_end();
+				ait != aend; ++ait) {
+			CG->markChanged(ait);
+		}
+		for (Value::use_iterator UI = F->use_begin(), E = F->use_end();
+				UI != E; ++UI) {
+			if (!isa<CallInst>(*UI) && !isa<InvokeInst>(*UI))
+				continue;
+
+			CallSite CS(cast<Instruction>(*UI));
+			if (CS.isCallee(UI))
+				CG->markChanged(CS.getInstruction());
+		}
+	}
+
+	for (std::vector<const Value*>::iterator vit = sliced.begin(), vend =
+			sliced.end(); vit != vend; ++vit) {
+		if (const Instruction *I = dyn_cast<Instruction>(*vit))
+			CG->addValue(I);
+	}
+	if (profiling())
+		prof->updateTime("BuildGraph", prof->timenow() - before);
+
+	CG->resolve();
+	if (profiling())
+		prof->setMemoryUsage();
+}
+
+template<class CGT>
+void InterProceduralRA<CGT>::update(
+		const SmallVectorImpl<const Instruction*> &added,
+		const SmallVectorImpl<const Value*> &removed) {
+	// Other range analyses may have run since runOnModule
+	MAX_BIT_INT = width;
+	updateMinMax(MAX_BIT_INT);
+	prof = &profile;
+
+	for (SmallVectorImpl<const Value*>::const_iterator vit = removed.begin(),
+			vend = removed.end(); vit != vend; ++vit) {
+		CG->removeValue(*vit);
+	}
+	for (SmallVectorImpl<const Instruction*>::const_iterator iit =
+			added.begin(), iend = added.end(); iit != iend; ++iit) {
+		CG->addValue(*iit);
+	}
+
+	// Only now are the uses of each removed value known, whatever the order
+	// of removed
+	CG->dropRemovedValues();
+	CG->resolve();
+}
+
 template<class CGT>
 unsigned InterProceduralRA<CGT>::getMaxBitWidth(Module &M) {
 	unsigned max = 0;
@@ -279,14 +953,25 @@ bool InterProceduralRA<CGT>::runOnModule(Module &M) {
 	// Constraint Graph
 //	if(CG) delete CG;
 	CG = new CGT();
+	prof = &profile;
 
 	MAX_BIT_INT = getMaxBitWidth(M);
 	updateMinMax(MAX_BIT_INT);
+	width = MAX_BIT_INT;
+
+	if (raDemand) {
+		// Put the functions in e-SSA form now; query builds the graph later
+		for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+			if (!I->isDeclaration() && !I->isVarArg())
+				getAnalysis<vSSA>(*I);
+		}
+		return true;
+	}
 
 	// Build the Constraint Graph by running on each function
-#ifdef STATS
-	Profile::TimeValue before = prof.timenow();
-#endif
+	Profile::TimeValue before;
+	if (profiling())
+		before = prof->timenow();
 	for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
 		// If the function is only a declaration, or if it has variable number of arguments, do not match
 		if (I->isDeclaration() || I->isVarArg())
@@ -295,15 +980,15 @@ bool InterProceduralRA<CGT>::runOnModule(Module &M) {
 			
 		CG->buildGraph(*I);
 		MatchParametersAndReturnValues(*I, *CG);
+		if (profiling())
+			prof->addCount("Functions", 1);
 	}
 	CG->buildVarNodes();
 
-#ifdef STATS
-	Profile::TimeValue elapsed = prof.timenow() - before;
-	prof.updateTime("BuildGraph", elapsed);
-
-	prof.setMemoryUsage();
-#endif
+	if (profiling()) {
+		prof->updateTime("BuildGraph", prof->timenow() - before);
+		prof->setMemoryUsage();
+	}
 #ifdef PRINT_DEBUG
 	std::string moduleIdentifier = M.getModuleIdentifier();
     int pos = moduleIdentifier.rfind("/");
@@ -314,6 +999,8 @@ bool InterProceduralRA<CGT>::runOnModule(Module &M) {
 #ifdef PRINT_DEBUG
 	CG->printToFile(*(M.begin()), "/tmp/" + mIdentifier + ".cgpos.dot");
 #endif
+	if (profiling())
+		prof->setMemoryUsage();
 	for (VarNodes::iterator vit = CG->getVars()->begin(), vend = CG->getVars()->end(); vit != vend; ++vit) {
 		Range RG = vit->second->getRange(); 
 		if (!RG.isUnknown()) {
@@ -326,6 +1013,13 @@ bool InterProceduralRA<CGT>::runOnModule(Module &M) {
 	return true;
 }
 
+template<class CGT>
+bool InterProceduralRA<CGT>::doFinalization(Module &M) {
+	writeProfile(M, profile, std::string(raDemand ? "inter-demand-" : "inter-")
+			+ CG->getSolverName());
+	return false;
+}
+
 template<class CGT>
 void InterProceduralRA<CGT>::MatchParametersAndReturnValues(Function &F,
 		ConstraintGraph &G) {
@@ -378,8 +1072,8 @@ void InterProceduralRA<CGT>::MatchParametersAndReturnValues(Function &F,
 	for (unsigned i = 0, e = Parameters.size(); i < e; ++i) {
 		VarNode *sink = G.addVarNode(Parameters[i].first);
 
-		matchers[i] = new PhiOp(new BasicInterval(), sink, NULL,
-				Instruction::PHI);
+		matchers[i] = new (G.allocate<PhiOp>()) PhiOp(new BasicInterval(),
+				sink, NULL, Instruction::PHI);
 
 		// Insert the operation in the graph.
 		G.getOprs()->insert(matchers[i]);
@@ -446,8 +1140,8 @@ void InterProceduralRA<CGT>::MatchParametersAndReturnValues(Function &F,
 			// Add caller instruction to the CG (it receives the return value)
 			to = G.addVarNode(caller);
 
-			PhiOp *phiOp = new PhiOp(new BasicInterval(), to, NULL,
-					Instruction::PHI);
+			PhiOp *phiOp = new (G.allocate<PhiOp>()) PhiOp(new BasicInterval(),
+					to, NULL, Instruction::PHI);
 
 			// Insert the operation in the graph.
 			G.getOprs()->insert(phiOp);
@@ -474,10 +1168,10 @@ void InterProceduralRA<CGT>::MatchParametersAndReturnValues(Function &F,
 template <class CGT>
 InterProceduralRA<CGT>::~InterProceduralRA(){
 #ifdef STATS
-	prof.printTime("BuildGraph");
-	prof.printTime("Nuutila");
-	prof.printTime("SCCs resolution");
-	prof.printMemoryUsage();
+	profile.printTime("BuildGraph");
+	profile.printTime("Nuutila");
+	profile.printTime("SCCs resolution");
+	profile.printMemoryUsage();
 	
 	std::ostringstream formated;
 	formated << 100 * (1.0 - ((double)(needBits) / usedBits));
@@ -520,24 +1214,147 @@ static RegisterPass<InterProceduralRACousot> Y("ra-inter-cousot", "Cousot's inte
 // ========================================================================== //
 // Range
 // ========================================================================== //
-Range::Range() {
-	Range(Min, Max);
+Range::Range() :
+		sl(MinWord), su(MaxWord), wide(NULL), width(MAX_BIT_INT), type(Regular) {
+	if (!isWord())
+		wide = new WideBounds(Min, Max);
 }
 
 Range::Range(APInt lb, APInt ub, RangeType rType) :
-		l(lb), u(ub), type(rType) {
+		sl(0), su(0), wide(NULL), width(MAX_BIT_INT), type(rType) {
+	if (isWord()) {
+		sl = lb.getSExtValue();
+		su = ub.getSExtValue();
+	} else {
+		wide = new WideBounds(lb, ub);
+	}
+}
+
+Range::Range(int64_t lb, int64_t ub, RangeType rType) :
+		sl(lb), su(ub), wide(NULL), width(MAX_BIT_INT), type(rType) {
+	assert(isWord() && "Machine word bounds for a range wider than 64 bits");
+}
+
+Range::Range(const Range& other) :
+		sl(other.sl), su(other.su), wide(NULL), width(other.width),
+		type(other.type) {
+	if (other.wide)
+		wide = new WideBounds(*other.wide);
+}
+
+Range& Range::operator=(const Range& other) {
+	if (this == &other)
+		return *this;
+
+	if (!other.wide) {
+		delete wide;
+		wide = NULL;
+	} else if (wide) {
+		*wide = *other.wide;
+	} else {
+		wide = new WideBounds(*other.wide);
+	}
+
+	sl = other.sl;
+	su = other.su;
+	width = other.width;
+	type = other.type;
+	return *this;
 }
 
 Range::~Range() {
+	delete wide;
+}
+
+void Range::setLower(const APInt& newl) {
+	if (isWord())
+		this->sl = newl.getSExtValue();
+	else
+		wide->l = newl;
+}
+
+void Range::setUpper(const APInt& newu) {
+	if (isWord())
+		this->su = newu.getSExtValue();
+	else
+		wide->u = newu;
 }
 
 bool Range::isMaxRange() const {
+	if (isWord())
+		return sl == MinWord && su == MaxWord;
 	return this->getLower().eq(Min) && this->getUpper().eq(Max);
 }
 
+bool Range::isInverted() const {
+	if (isWord())
+		return sl > su;
+	return this->getLower().sgt(this->getUpper());
+}
+
+// Arithmetic on machine words, with the overflow rules of the APInt paths
+// below. A sum that does not fit in [MinWord, MaxWord] is reported to add,
+// which widens the bound it was computing to -inf or +inf. Differences and
+// products saturate instead, to -inf or +inf by the sign of the exact result.
+static int64_t addWords(int64_t a, int64_t b, bool &overflow) {
+	overflow = (b > 0 && a > MaxWord - b) || (b < 0 && a < MinWord - b);
+	return overflow ? 0 : a + b;
+}
+
+static int64_t subWords(int64_t a, int64_t b) {
+	if (b > 0 && a < MinWord + b)
+		return MinWord;
+	if (b < 0 && a > MaxWord + b)
+		return MaxWord;
+	return a - b;
+}
+
+static int64_t mulWords(int64_t a, int64_t b) {
+	if (a == 0 || b == 0)
+		return 0;
+
+	// Work on magnitudes, so that MinWord does not overflow when negated.
+	bool negative = (a < 0) != (b < 0);
+	uint64_t ua = a < 0 ? 0 - (uint64_t)a : (uint64_t)a;
+	uint64_t ub = b < 0 ? 0 - (uint64_t)b : (uint64_t)b;
+	uint64_t limit = negative ? (uint64_t)MaxWord + 1 : (uint64_t)MaxWord;
+
+	if (ua > limit / ub)
+		return negative ? MinWord : MaxWord;
+
+	uint64_t product = ua * ub;
+	return negative ? (int64_t)(0 - product) : (int64_t)product;
+}
+
+// x * y where either operand may be -inf or +inf (see MUL_HELPER).
+static int64_t mulBounds(int64_t x, int64_t y) {
+	if (x == MaxWord || x == MinWord || y == MaxWord || y == MinWord) {
+		if (x == 0 || y == 0)
+			return 0;
+		return (x < 0) == (y < 0) ? MaxWord : MinWord;
+	}
+	return mulWords(x, y);
+}
+
 /// Add and Mul are commutatives. So, they are a little different 
 /// of the other operations.
 Range Range::add(const Range& other) {
+	if (isWord()) {
+		int64_t l = MinWord, u = MaxWord;
+		bool overflow;
+		if (sl != MinWord && other.sl != MinWord) {
+			l = addWords(sl, other.sl, overflow);
+			if (overflow)
+				l = MinWord;
+		}
+		if (su != MaxWord && other.su != MaxWord) {
+			u = addWords(su, other.su, overflow);
+			if (overflow)
+				u = MaxWord;
+		}
+		return Range(l, u);
+	}
+
 	const APInt &a = this->getLower();
 	const APInt &b = this->getUpper();
 	const APInt &c = other.getLower();
@@ -563,25 +1380,40 @@ Range Range::add(const Range& other) {
 /// max (a − c, a − d, b − c, b − d)] = [a − d, b − c]
 /// The other operations are just like this operation.
 Range Range::sub(const Range& other) {
+	if (isWord()) {
+		int64_t l = MinWord, u = MaxWord;
+		if (sl != MinWord && other.su != MaxWord)
+			l = subWords(sl, other.su);
+		if (su != MaxWord && other.sl != MinWord)
+			u = subWords(su, other.sl);
+		return Range(l, u);
+	}
+
 	const APInt &a = this->getLower();
 	const APInt &b = this->getUpper();
 	const APInt &c = other.getLower();
 	const APInt &d = other.getUpper();
 	APInt l, u;
+	bool overflow;
 
+	// Overflows saturate, as subWords does
 	//a-d
 	if (a.eq(Min) || d.eq(Max))
 		l = Min;
-	else
-		//FIXME: handle overflow when a-d < Min
-		l = a - d;
+	else {
+		l = a.ssub_ov(d, overflow);
+		if (overflow)
+			l = a.isNegative() ? Min : Max;
+	}
 
 	//b-c
 	if (b.eq(Max) || c.eq(Min))
 		u = Max;
-	else
-		//FIXME: handle overflow when b-c > Max
-		u = b - c;
+	else {
+		u = b.ssub_ov(c, overflow);
+		if (overflow)
+			u = b.isNegative() ? Min : Max;
+	}
 
 	return Range(l, u);
 }
@@ -608,6 +1440,16 @@ Range Range::mul(const Range& other) {
 		return Range(Min, Max);
 	}
 
+	if (isWord()) {
+		int64_t candidates[4];
+		candidates[0] = mulBounds(sl, other.sl);
+		candidates[1] = mulBounds(sl, other.su);
+		candidates[2] = mulBounds(su, other.sl);
+		candidates[3] = mulBounds(su, other.su);
+		return Range(*std::min_element(candidates, candidates + 4),
+				*std::max_element(candidates, candidates + 4));
+	}
+
 	const APInt &a = this->getLower();
 	const APInt &b = this->getUpper();
 	const APInt &c = other.getLower();
@@ -1179,6 +2021,9 @@ Range Range::intersectWith(const Range& other) const {
 		return *this;
 	}
 
+	if (isWord())
+		return Range(std::max(sl, other.sl), std::min(su, other.su));
+
 	APInt l = getLower().sgt(other.getLower()) ? getLower() : other.getLower();
 	APInt u = getUpper().slt(other.getUpper()) ? getUpper() : other.getUpper();
 	return Range(l, u);
@@ -1201,17 +2046,24 @@ Range Range::unionWith(const Range& other) const {
 		return *this;
 	}
 
+	if (isWord())
+		return Range(std::min(sl, other.sl), std::max(su, other.su));
+
 	APInt l = getLower().slt(other.getLower()) ? getLower() : other.getLower();
 	APInt u = getUpper().sgt(other.getUpper()) ? getUpper() : other.getUpper();
 	return Range(l, u);
 }
 
 bool Range::operator==(const Range& other) const {
+	if (isWord())
+		return type == other.type && sl == other.sl && su == other.su;
 	return this->type == other.type && getLower().eq(other.getLower())
 			&& getUpper().eq(other.getUpper());
 }
 
 bool Range::operator!=(const Range& other) const {
+	if (isWord())
+		return type != other.type || sl != other.sl || su != other.su;
 	return this->type != other.type || getLower().ne(other.getLower())
 			|| getUpper().ne(other.getUpper());
 }
@@ -1227,6 +2079,18 @@ void Range::print(raw_ostream& OS) const {
 		return;
 	}
 
+	if (isWord()) {
+		if (sl == MinWord)
+			OS << "[-inf, ";
+		else
+			OS << "[" << sl << ", ";
+		if (su == MaxWord)
+			OS << "+inf]";
+		else
+			OS << su << "]";
+		return;
+	}
+
 	if (getLower().eq(Min)) {
 		OS << "[-inf, ";
 	} else {
@@ -1672,7 +2536,7 @@ Range BinaryOp::eval() const {
 		}
 		
 		// If resulting interval has become inconsistent, set it to max range for safety
-		if (result.getLower().sgt(result.getUpper())) {
+		if (result.isInverted()) {
 			result = Range(Min, Max);
 		}
 
@@ -1841,14 +2705,24 @@ ConstraintGraph::~ConstraintGraph() {
 //	errs() << "\nConstraintGraph::~ConstraintGraph : "<< this->vars.size();
 	//delete symbMap;
 
+	// The arena releases the memory; the destructors release what the
+	// nodes own (wide APInts, intervals and source lists)
 	for (VarNodes::iterator vit = vars.begin(), vend = vars.end();
 			vit != vend; ++vit) {
-		delete vit->second;
+		vit->second->~VarNode();
 	}
 
 	for (GenOprs::iterator oit = oprs.begin(), oend = oprs.end(); oit != oend;
 			++oit) {
-		delete *oit;
+		(*oit)->~BasicOp();
+	}
+
+	for (unsigned i = 0, e = removedVars.size(); i < e; ++i) {
+		removedVars[i]->~VarNode();
+	}
+
+	for (unsigned i = 0, e = removedOprs.size(); i < e; ++i) {
+		removedOprs[i]->~BasicOp();
 	}
 
 	for (ValuesBranchMap::iterator vit = valuesBranchMap.begin(), vend =
@@ -1877,8 +2751,9 @@ VarNode* ConstraintGraph::addVarNode(const Value* V) {
 		return vit->second;
 	}
 
-	VarNode* node = new VarNode(V);
+	VarNode* node = new (allocate<VarNode>()) VarNode(V);
 	this->vars.insert(std::make_pair(V, node));
+	this->newVars.push_back(V);
 
 	// Inserts the node in the use map list.
 	SmallPtrSet<BasicOp*, 8> useList;
@@ -1914,7 +2789,7 @@ void ConstraintGraph::addUnaryOp(const Instruction* I) {
 	
 #ifndef OVERFLOWHANDLER
 	// Create the operation using the intersect to constrain sink's interval.
-	UOp = new UnaryOp(new BasicInterval(), sink, I, source,
+	UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(), sink, I, source,
 			I->getOpcode());
 #else
 	// I can only be an Add instruction if he is a newdef overflow instruction
@@ -1941,7 +2816,7 @@ void ConstraintGraph::addUnaryOp(const Instruction* I) {
 					lower -= constant;
 				}
 				
-				UOp = new UnaryOp(new BasicInterval(lower, upper), sink, I, source, I->getOpcode());
+				UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(lower, upper), sink, I, source, I->getOpcode());
 				break;
 				
 			case Instruction::Sub:
@@ -1957,7 +2832,7 @@ void ConstraintGraph::addUnaryOp(const Instruction* I) {
 					upper += constant;
 				}
 				
-				UOp = new UnaryOp(new BasicInterval(lower, upper), sink, I, source, I->getOpcode());
+				UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(lower, upper), sink, I, source, I->getOpcode());
 				break;
 			
 			case Instruction::Mul:
@@ -1976,7 +2851,7 @@ void ConstraintGraph::addUnaryOp(const Instruction* I) {
 					candidates[1] = swap;
 				}
 				
-				UOp = new UnaryOp(new BasicInterval(candidates[0], candidates[1]), sink, I, source, I->getOpcode());
+				UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(candidates[0], candidates[1]), sink, I, source, I->getOpcode());
 				break;
 			
 			case Instruction::Trunc:
@@ -1995,13 +2870,13 @@ void ConstraintGraph::addUnaryOp(const Instruction* I) {
 				
 				Range truncInterval(minvalue, maxvalue, Regular);
 				
-				UOp = new UnaryOp(new BasicInterval(truncInterval), sink, I, source, I->getOpcode());
+				UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(truncInterval), sink, I, source, I->getOpcode());
 				break;
 		}
 	}
 	else {
 		// Create the operation using the intersect to constrain sink's interval.
-		UOp = new UnaryOp(new BasicInterval(), sink, I, source,
+		UOp = new (allocate<UnaryOp>()) UnaryOp(new BasicInterval(), sink, I, source,
 		I->getOpcode());
 	}
 #endif
@@ -2029,7 +2904,7 @@ void ConstraintGraph::addBinaryOp(const Instruction* I) {
 
 	// Create the operation using the intersect to constrain sink's interval.
 	BasicInterval* BI = new BasicInterval();
-	BinaryOp* BOp = new BinaryOp(BI, sink, I, source1, source2, I->getOpcode());
+	BinaryOp* BOp = new (allocate<BinaryOp>()) BinaryOp(BI, sink, I, source1, source2, I->getOpcode());
 
 	// Insert the operation in the graph.
 	this->oprs.insert(BOp);
@@ -2046,7 +2921,8 @@ void ConstraintGraph::addBinaryOp(const Instruction* I) {
 void ConstraintGraph::addPhiOp(const PHINode* Phi) {
 	// Create the sink.
 	VarNode* sink = addVarNode(Phi);
-	PhiOp* phiOp = new PhiOp(new BasicInterval(), sink, Phi, Phi->getOpcode());
+	PhiOp* phiOp = new (allocate<PhiOp>()) PhiOp(new BasicInterval(), sink,
+			Phi, Phi->getOpcode());
 
 	// Insert the operation in the graph.
 	this->oprs.insert(phiOp);
@@ -2115,10 +2991,10 @@ void ConstraintGraph::addSigmaOp(const PHINode* Sigma) {
 		}
 
 		if (BItv == NULL) {
-			sigmaOp = new SigmaOp(new BasicInterval(), sink, Sigma, source,
+			sigmaOp = new (allocate<SigmaOp>()) SigmaOp(new BasicInterval(), sink, Sigma, source,
 					Sigma->getOpcode());
 		} else {
-			sigmaOp = new SigmaOp(BItv, sink, Sigma, source,
+			sigmaOp = new (allocate<SigmaOp>()) SigmaOp(BItv, sink, Sigma, source,
 					Sigma->getOpcode());
 		}
 
@@ -2371,7 +3247,7 @@ void ConstraintGraph::buildValueBranchMap(const BranchInst *br) {
 	}
 }
 
-void ConstraintGraph::buildValueMaps(const Function& F) {
+void ConstraintGraph::buildValueMaps(const Function& F, const ValueSlice *slice) {
 	for (Function::const_iterator iBB = F.begin(), eBB = F.end(); iBB != eBB;
 			++iBB) {
 		const TerminatorInst* ti = iBB->getTerminator();
@@ -2379,8 +3255,16 @@ void ConstraintGraph::buildValueMaps(const Function& F) {
 		const SwitchInst* sw = dyn_cast<SwitchInst>(ti);
 
 		if (br) {
+			// Only the comparisons on values of the slice can create its sigmas
+			const ICmpInst *ici = br->isConditional() ?
+					dyn_cast<ICmpInst>(br->getCondition()) : NULL;
+			if (slice && (!ici || (!slice->count(ici->getOperand(0))
+					&& !slice->count(ici->getOperand(1)))))
+				continue;
 			buildValueBranchMap(br);
 		} else if (sw) {
+			if (slice && !slice->count(sw->getCondition()))
+				continue;
 			buildValueSwitchMap(sw);
 		}
 	}
@@ -2394,7 +3278,7 @@ void ConstraintGraph::buildValueMaps(const Function& F) {
 //}
 
 /*
- * Comparison function used to sort the constant vector
+ * Comparison function used to sort the thresholds
  */
 bool compareAPInt(const APInt &v1, const APInt &v2)
 {
@@ -2402,149 +3286,282 @@ bool compareAPInt(const APInt &v1, const APInt &v2)
 }
 
 /*
- * Used to insert constant in the right position
+ * Orders positions in the thresholds by the constant they point to
  */
-void ConstraintGraph::insertConstantIntoVector(APInt constantval)
-{
-	if (constantval.getBitWidth() < MAX_BIT_INT) {
-		constantval = constantval.sext(MAX_BIT_INT);
+struct ThresholdLess {
+	const std::vector<APInt> &thresholds;
+	ThresholdLess(const std::vector<APInt> &thresholds) :
+			thresholds(thresholds) {}
+	bool operator()(unsigned idx, const APInt &val) const {
+		return thresholds[idx].slt(val);
+	}
+	bool operator()(const APInt &val, unsigned idx) const {
+		return val.slt(thresholds[idx]);
 	}
+};
 
-	constantvector.push_back(constantval);
+void JumpSet::finish()
+{
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
 }
 
 /*
- * Get the first constant from vector greater than val
+ * Get the first threshold greater than or equal to val
  */
-APInt getFirstGreaterFromVector(const SmallVector<APInt, 2> &constantvector, const APInt &val)
+APInt JumpSet::getFirstGreater(const APInt &val) const
 {
-	for (SmallVectorImpl<APInt>::const_iterator vit = constantvector.begin(), vend = constantvector.end(); vit != vend; ++vit) {
-		const APInt &vapint = *vit;
-
-		if (vapint.sge(val)) {
-			return vapint;
-		}
+	SmallVectorImpl<unsigned>::const_iterator iit = std::lower_bound(
+			indices.begin(), indices.end(), val, ThresholdLess(*thresholds));
+	if (iit != indices.end()) {
+		return (*thresholds)[*iit];
 	}
 
 	return Max;
 }
 
 /*
- * Get the first constant from vector less than val
+ * Get the first threshold less than or equal to val
  */
-APInt getFirstLessFromVector(const SmallVector<APInt, 2> &constantvector, const APInt &val)
+APInt JumpSet::getFirstLess(const APInt &val) const
 {
-	for (SmallVectorImpl<APInt>::const_reverse_iterator vit = constantvector.rbegin(), vend = constantvector.rend(); vit != vend; ++vit) {
-		const APInt &vapint = *vit;
+	SmallVectorImpl<unsigned>::const_iterator iit = std::upper_bound(
+			indices.begin(), indices.end(), val, ThresholdLess(*thresholds));
+	if (iit != indices.begin()) {
+		return (*thresholds)[*(iit - 1)];
+	}
 
-		if (vapint.sle(val)) {
-			return vapint;
+	return Min;
+}
+
+// Adds constant to the thresholds of the graph and to the list of its user
+static void collectThreshold(const APInt &constant,
+		std::vector<APInt> &thresholds, SmallVectorImpl<APInt> &list)
+{
+	if (constant.getBitWidth() < MAX_BIT_INT) {
+		list.push_back(constant.sext(MAX_BIT_INT));
+	} else {
+		list.push_back(constant);
+	}
+	thresholds.push_back(list.back());
+}
+
+// The thresholds that V brings to its SCC: itself if it is a constant, and
+// the constant sources of the operation that defines it
+static void collectVarThresholds(const Value *V, const DefMap &defMap,
+		std::vector<APInt> &thresholds, SmallVectorImpl<APInt> &list)
+{
+	if (const ConstantInt *ci = dyn_cast<ConstantInt>(V)) {
+		collectThreshold(ci->getValue(), thresholds, list);
+	}
+
+	DefMap::const_iterator dfit = defMap.find(V);
+	if (dfit == defMap.end()) {
+		return;
+	}
+
+	// Handle BinaryOp case
+	if (const BinaryOp *bop = dyn_cast<BinaryOp>(dfit->second)) {
+		const Value *sourceval1 = bop->getSource1()->getValue();
+		const Value *sourceval2 = bop->getSource2()->getValue();
+
+		if (const ConstantInt *const1 = dyn_cast<ConstantInt>(sourceval1)) {
+			collectThreshold(const1->getValue(), thresholds, list);
+		}
+		if (const ConstantInt *const2 = dyn_cast<ConstantInt>(sourceval2)) {
+			collectThreshold(const2->getValue(), thresholds, list);
 		}
 	}
+	// Handle PhiOp case
+	else if (const PhiOp *pop = dyn_cast<PhiOp>(dfit->second)) {
+		for (unsigned i = 0, e = pop->getNumSources(); i < e; ++i) {
+			const Value *sourceval = pop->getSource(i)->getValue();
 
-	return Min;
+			if (const ConstantInt *consti = dyn_cast<ConstantInt>(sourceval)) {
+				collectThreshold(consti->getValue(), thresholds, list);
+			}
+		}
+	}
+}
+
+// The thresholds of the constant intersection of a sigma
+static void collectSigmaThresholds(const SigmaOp *sigma,
+		std::vector<APInt> &thresholds, SmallVectorImpl<APInt> &list)
+{
+	Range rintersect = sigma->getIntersect()->getRange();
+
+	const APInt lb = rintersect.getLower();
+	const APInt ub = rintersect.getUpper();
+
+	if (lb.ne(Min) && lb.ne(Max)) {
+		collectThreshold(lb, thresholds, list);
+	}
+	if (ub.ne(Min) && ub.ne(Max)) {
+		collectThreshold(ub, thresholds, list);
+	}
+}
+
+// Turns constants into their positions in the sorted thresholds
+static void indexThresholds(const SmallVectorImpl<APInt> &constants,
+		const std::vector<APInt> &thresholds, SmallVectorImpl<unsigned> &indices)
+{
+	for (SmallVectorImpl<APInt>::const_iterator cit = constants.begin(),
+			cend = constants.end(); cit != cend; ++cit) {
+		indices.push_back(std::lower_bound(thresholds.begin(), thresholds.end(),
+				*cit, compareAPInt) - thresholds.begin());
+	}
 }
 
 /*
- * Create a vector containing all constants related to the component
- * They include:
- *   - Constants inside component
- *   - Constants that are source of an edge to an entry point
- *   - Constants from intersections generated by sigmas
+ * Collects, once for the whole graph, the constants that the SCCs use as
+ * jump-set thresholds. An SCC gets:
+ *   - Its constants (TODO: may not be necessary, since components with more
+ *     than 1 node never have a constant inside them)
+ *   - The constants that are sources of the operations defining its variables
+ *   - The bounds of the constant intersections of its sigmas
  */
-void ConstraintGraph::buildConstantVector(const SmallPtrSet<VarNode*, 32> &component, const UseMap &compusemap)
+void ConstraintGraph::buildThresholds()
 {
-	// Remove all elements from the vector
-	constantvector.clear();
-	
-	// Get constants inside component (TODO: may not be necessary, since components with more than 1 node never have a constant inside them)
-	for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend = component.end(); cit != cend; ++cit) {
-		const Value *V = (*cit)->getValue();
-		const ConstantInt *ci = NULL;
-		
-		if ((ci = dyn_cast<ConstantInt>(V))) {
-			insertConstantIntoVector(ci->getValue());
+	thresholds.clear();
+	varThresholds.clear();
+	sigmaThresholds.clear();
+
+	DenseMap<const Value*, SmallVector<APInt, 2> > varConstants;
+	DenseMap<const BasicOp*, SmallVector<APInt, 2> > sigmaConstants;
+
+	for (VarNodes::iterator vit = vars.begin(), vend = vars.end(); vit != vend;
+			++vit) {
+		SmallVector<APInt, 2> list;
+		collectVarThresholds(vit->first, defMap, thresholds, list);
+		if (!list.empty()) {
+			varConstants[vit->first] = list;
 		}
 	}
 
-	// Get constants that are sources of operations whose sink belong to the component
-	for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend = component.end(); cit != cend; ++cit) {
-		const VarNode *var = (*cit);
-		const Value *V = var->getValue();
+	// Get constants used in intersections generated for sigmas
+	for (GenOprs::iterator oit = oprs.begin(), oend = oprs.end(); oit != oend;
+			++oit) {
+		const SigmaOp *sigma = dyn_cast<SigmaOp>(*oit);
 
-		DefMap::iterator dfit = defMap.find(V);
-		if (dfit == defMap.end()) {
+		// Symbolic intervals are discarded, as they don't have fixed values yet
+		if (!sigma || isa<SymbInterval>(sigma->getIntersect())) {
 			continue;
 		}
 
-		// Handle BinaryOp case
-		const BinaryOp *bop = dyn_cast<BinaryOp>(dfit->second);
-		const PhiOp *pop = dyn_cast<PhiOp>(dfit->second);
-		if (bop) {
-			const VarNode *source1 = bop->getSource1();
-			const Value *sourceval1 = source1->getValue();
-			const VarNode *source2 = bop->getSource2();
-			const Value *sourceval2 = source2->getValue();
+		SmallVector<APInt, 2> list;
+		collectSigmaThresholds(sigma, thresholds, list);
+		if (!list.empty()) {
+			sigmaConstants[sigma] = list;
+		}
+	}
 
-			const ConstantInt *const1, *const2;
+	// Sort in ascending order and remove duplicates
+	std::sort(thresholds.begin(), thresholds.end(), compareAPInt);
+	thresholds.erase(std::unique(thresholds.begin(), thresholds.end()),
+			thresholds.end());
 
-			if ((const1 = dyn_cast<ConstantInt>(sourceval1))) {
-				insertConstantIntoVector(const1->getValue());
-			}
-			if ((const2 = dyn_cast<ConstantInt>(sourceval2))) {
-				insertConstantIntoVector(const2->getValue());
-			}
-		}
-		// Handle PhiOp case
-		else if (pop) {
-			for (unsigned i = 0, e = pop->getNumSources(); i < e; ++i) {
-				const VarNode *source = pop->getSource(i);
-				const Value *sourceval = source->getValue();
+	for (DenseMap<const Value*, SmallVector<APInt, 2> >::iterator it =
+			varConstants.begin(), end = varConstants.end(); it != end; ++it) {
+		indexThresholds(it->second, thresholds, varThresholds[it->first]);
+	}
+	for (DenseMap<const BasicOp*, SmallVector<APInt, 2> >::iterator it =
+			sigmaConstants.begin(), end = sigmaConstants.end(); it != end; ++it) {
+		indexThresholds(it->second, thresholds, sigmaThresholds[it->first]);
+	}
+}
+
+/*
+ * Indexes again the thresholds of values, which resolve is about to solve.
+ * If one of them is not in the index yet, the positions of the others
+ * change, so the whole index is built again. The thresholds of the
+ * operations taken out of the graph stay in the index until then.
+ */
+void ConstraintGraph::updateThresholds(
+		const SmallPtrSet<const Value*, 64> &values)
+{
+	std::vector<APInt> found;
+	DenseMap<const Value*, SmallVector<APInt, 2> > varConstants;
+	DenseMap<const BasicOp*, SmallVector<APInt, 2> > sigmaConstants;
 
-				const ConstantInt *consti;
+	for (SmallPtrSetIterator<const Value*> vit = values.begin(), vend =
+			values.end(); vit != vend; ++vit) {
+		const Value *V = *vit;
+		collectVarThresholds(V, defMap, found, varConstants[V]);
 
-				if ((consti = dyn_cast<ConstantInt>(sourceval))) {
-					insertConstantIntoVector(consti->getValue());
-				}
-			}
+		DefMap::iterator dfit = defMap.find(V);
+		const SigmaOp *sigma = dfit == defMap.end() ? NULL :
+				dyn_cast<SigmaOp>(dfit->second);
+		if (sigma && !isa<SymbInterval>(sigma->getIntersect())) {
+			collectSigmaThresholds(sigma, found, sigmaConstants[sigma]);
 		}
 	}
 
-	// Get constants used in intersections generated for sigmas
-	for (UseMap::const_iterator umit = compusemap.begin(), umend = compusemap.end(); umit != umend; ++umit) {
-		for (SmallPtrSetIterator<BasicOp*> sit = umit->second.begin(), send = umit->second.end(); sit != send; ++sit) {
-			const SigmaOp *sigma = dyn_cast<SigmaOp>(*sit);
+	for (std::vector<APInt>::iterator fit = found.begin(), fend = found.end();
+			fit != fend; ++fit) {
+		if (!std::binary_search(thresholds.begin(), thresholds.end(), *fit,
+				compareAPInt)) {
+			buildThresholds();
+			return;
+		}
+	}
 
-			if (sigma) {
-				// Symbolic intervals are discarded, as they don't have fixed values yet
-				if (isa<SymbInterval>(sigma->getIntersect())) {
-					continue;
-				}
+	for (DenseMap<const Value*, SmallVector<APInt, 2> >::iterator it =
+			varConstants.begin(), end = varConstants.end(); it != end; ++it) {
+		varThresholds.erase(it->first);
+		if (!it->second.empty()) {
+			indexThresholds(it->second, thresholds, varThresholds[it->first]);
+		}
+	}
+	for (DenseMap<const BasicOp*, SmallVector<APInt, 2> >::iterator it =
+			sigmaConstants.begin(), end = sigmaConstants.end(); it != end; ++it) {
+		sigmaThresholds.erase(it->first);
+		if (!it->second.empty()) {
+			indexThresholds(it->second, thresholds, sigmaThresholds[it->first]);
+		}
+	}
+}
 
-				Range rintersect = sigma->getIntersect()->getRange();
+/*
+ * Gathers the thresholds of component from the index
+ */
+void ConstraintGraph::buildJumpSet(const SmallPtrSet<VarNode*, 32> &component,
+		const UseMap &compusemap, JumpSet &jumpset)
+{
+	for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend = component.end(); cit != cend; ++cit) {
+		DenseMap<const Value*, SmallVector<unsigned, 2> >::const_iterator vtit =
+				varThresholds.find((*cit)->getValue());
+		if (vtit == varThresholds.end()) {
+			continue;
+		}
 
-				const APInt lb = rintersect.getLower();
-				const APInt ub = rintersect.getUpper();
+		for (SmallVectorImpl<unsigned>::const_iterator iit = vtit->second.begin(),
+				iend = vtit->second.end(); iit != iend; ++iit) {
+			jumpset.addIndex(*iit);
+		}
+	}
 
-				if (lb.ne(Min) && lb.ne(Max)) {
-					insertConstantIntoVector(lb);
-				}
-				if (ub.ne(Min) && ub.ne(Max)) {
-					insertConstantIntoVector(ub);
-				}
+	for (UseMap::const_iterator umit = compusemap.begin(), umend = compusemap.end(); umit != umend; ++umit) {
+		for (SmallPtrSetIterator<BasicOp*> sit = umit->second.begin(), send = umit->second.end(); sit != send; ++sit) {
+			DenseMap<const BasicOp*, SmallVector<unsigned, 2> >::const_iterator stit =
+					sigmaThresholds.find(*sit);
+			if (stit == sigmaThresholds.end()) {
+				continue;
+			}
+
+			for (SmallVectorImpl<unsigned>::const_iterator iit = stit->second.begin(),
+					iend = stit->second.end(); iit != iend; ++iit) {
+				jumpset.addIndex(*iit);
 			}
 		}
 	}
 
-	// Sort vector in ascending order and remove duplicates
-	std::sort(constantvector.begin(), constantvector.end(), compareAPInt);
-	std::unique(constantvector.begin(), constantvector.end());
+	jumpset.finish();
 }
 
 /// Iterates through all instructions in the function and builds the graph.
-void ConstraintGraph::buildGraph(const Function& F) {
+void ConstraintGraph::buildGraph(const Function& F, const ValueSlice *slice) {
 	this->func = &F;
-	buildValueMaps(F);
+	buildValueMaps(F, slice);
 
 //	for (Function::const_arg_iterator ait = F.arg_begin(), aend = F.arg_end(); ait != aend; ++ait) {
 //		const Value *argument = &*ait;
@@ -2567,6 +3584,10 @@ void ConstraintGraph::buildGraph(const Function& F) {
 			continue;
 		}
 
+		if (slice && !slice->count(&*I)) {
+			continue;
+		}
+
 		buildOperations(&*I);
 	}
 }
@@ -2577,6 +3598,7 @@ void ConstraintGraph::buildVarNodes() {
 	for (; bgn != end; ++bgn) {
 		bgn->second->init(!this->defMap.count(bgn->first));
 	}
+	newVars.clear();
 }
 
 //FIXME: do it just for component
@@ -2587,7 +3609,7 @@ void CropDFS::storeAbstractStates(const SmallPtrSet<VarNode*, 32> *component) {
 	}
 }
 
-bool Meet::fixed(BasicOp* op, const SmallVector<APInt, 2> *constantvector){
+bool Meet::fixed(BasicOp* op, const JumpSet *jumpset){
 	Range oldInterval = op->getSink()->getRange();
 	Range newInterval = op->eval();
 	
@@ -2596,41 +3618,55 @@ bool Meet::fixed(BasicOp* op, const SmallVector<APInt, 2> *constantvector){
 	return oldInterval != newInterval;
 }
 
-/// This is the meet operator of the growth analysis. The growth analysis
-/// will change the bounds of each variable, if necessary. Initially, each
-/// variable is bound to either the undefined interval, e.g. [., .], or to
-/// a constant interval, e.g., [3, 15]. After this analysis runs, there will
-/// be no undefined interval. Each variable will be either bound to a
-/// constant interval, or to [-, c], or to [c, +], or to [-, +].
-bool Meet::widen(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
-	assert(constantvector != NULL && "Invalid pointer to constant vector");
-
+// The meet operators below are written once over the type of the bounds:
+// machine words while Range::fitsWord() holds, APInts otherwise.
+template<class B> struct Bounds;
+
+template<> struct Bounds<int64_t> {
+	static int64_t lower(const Range &R) {return R.getLowerWord();}
+	static int64_t upper(const Range &R) {return R.getUpperWord();}
+	static int64_t min() {return MinWord;}
+	static int64_t max() {return MaxWord;}
+	static bool slt(int64_t a, int64_t b) {return a < b;}
+	static APInt toAPInt(int64_t v) {return APInt(MAX_BIT_INT, v, true);}
+	static int64_t fromAPInt(const APInt &v) {return v.getSExtValue();}
+};
+
+template<> struct Bounds<APInt> {
+	static APInt lower(const Range &R) {return R.getLower();}
+	static APInt upper(const Range &R) {return R.getUpper();}
+	static APInt min() {return Min;}
+	static APInt max() {return Max;}
+	static bool slt(const APInt &a, const APInt &b) {return a.slt(b);}
+	static APInt toAPInt(const APInt &v) {return v;}
+	static APInt fromAPInt(const APInt &v) {return v;}
+};
+
+template<class B>
+static bool widenMeet(BasicOp* op, const JumpSet *jumpset) {
+	typedef Bounds<B> T;
 	Range oldInterval = op->getSink()->getRange();
 	Range newInterval = op->eval();
 
-	APInt oldLower = oldInterval.getLower();
-	APInt oldUpper = oldInterval.getUpper();
-	APInt newLower = newInterval.getLower();
-	APInt newUpper = newInterval.getUpper();
-
-	// Jump-set
-	APInt nlconstant = getFirstLessFromVector(*constantvector, newLower);
-	APInt nuconstant = getFirstGreaterFromVector(*constantvector, newUpper);
-
 	if (oldInterval.isUnknown()) {
 		op->getSink()->setRange(newInterval);
 	} else {
-		if (newLower.slt(oldLower) && newUpper.sgt(oldUpper)) {
+		B oldLower = T::lower(oldInterval);
+		B oldUpper = T::upper(oldInterval);
+		B newLower = T::lower(newInterval);
+		B newUpper = T::upper(newInterval);
+		bool lowerGrows = T::slt(newLower, oldLower);
+		bool upperGrows = T::slt(oldUpper, newUpper);
+
+		// Jump-set
+		B nlconstant = oldLower, nuconstant = oldUpper;
+		if (lowerGrows)
+			nlconstant = T::fromAPInt(jumpset->getFirstLess(T::toAPInt(newLower)));
+		if (upperGrows)
+			nuconstant = T::fromAPInt(jumpset->getFirstGreater(T::toAPInt(newUpper)));
+
+		if (lowerGrows || upperGrows)
 			op->getSink()->setRange(Range(nlconstant, nuconstant));
-		} else {
-			if (newLower.slt(oldLower)) {
-				op->getSink()->setRange(Range(nlconstant, oldUpper));
-			} else {
-				if (newUpper.sgt(oldUpper)) {
-					op->getSink()->setRange(Range(oldLower, nuconstant));
-				}
-			}
-		}
 	}
 
 	Range sinkInterval = op->getSink()->getRange();
@@ -2638,73 +3674,102 @@ bool Meet::widen(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
 	return oldInterval != sinkInterval;
 }
 
-bool Meet::growth(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
+/// This is the meet operator of the growth analysis. The growth analysis
+/// will change the bounds of each variable, if necessary. Initially, each
+/// variable is bound to either the undefined interval, e.g. [., .], or to
+/// a constant interval, e.g., [3, 15]. After this analysis runs, there will
+/// be no undefined interval. Each variable will be either bound to a
+/// constant interval, or to [-, c], or to [c, +], or to [-, +].
+bool Meet::widen(BasicOp* op, const JumpSet *jumpset) {
+	assert(jumpset != NULL && "Invalid pointer to jump-set");
+
+	if (Range::fitsWord())
+		return widenMeet<int64_t>(op, jumpset);
+	return widenMeet<APInt>(op, jumpset);
+}
+
+template<class B>
+static bool growthMeet(BasicOp* op) {
+	typedef Bounds<B> T;
 	Range oldInterval = op->getSink()->getRange();
 	Range newInterval = op->eval();
 
 	if (oldInterval.isUnknown())
 		op->getSink()->setRange(newInterval);
 	else {
-		APInt oldLower = oldInterval.getLower();
-		APInt oldUpper = oldInterval.getUpper();
-		APInt newLower = newInterval.getLower();
-		APInt newUpper = newInterval.getUpper();
-		if (newLower.slt(oldLower))
-			if (newUpper.sgt(oldUpper))
-				op->getSink()->setRange(Range());
+		B oldLower = T::lower(oldInterval);
+		B oldUpper = T::upper(oldInterval);
+		B newLower = T::lower(newInterval);
+		B newUpper = T::upper(newInterval);
+		if (T::slt(newLower, oldLower))
+			if (T::slt(oldUpper, newUpper))
+				op->getSink()->setRange(Range(T::min(), T::max()));
 			else
-				op->getSink()->setRange(Range(Min, oldUpper));
-		else if (newUpper.sgt(oldUpper))
-			op->getSink()->setRange(Range(oldLower, Max));
+				op->getSink()->setRange(Range(T::min(), oldUpper));
+		else if (T::slt(oldUpper, newUpper))
+			op->getSink()->setRange(Range(oldLower, T::max()));
 	}
 	Range sinkInterval = op->getSink()->getRange();
 	LOG_TRANSACTION("GROWTH::" << op->getSink()->getValue()->getName() << ": " << oldInterval << " -> " << sinkInterval)
 	return oldInterval != sinkInterval;
 }
 
-/// This is the meet operator of the cropping analysis. Whereas the growth
-/// analysis expands the bounds of each variable, regardless of intersections
-/// in the constraint graph, the cropping analysis shrinks these bounds back
-/// to ranges that respect the intersections.
-bool Meet::narrow(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
+bool Meet::growth(BasicOp* op, const JumpSet *jumpset) {
+	if (Range::fitsWord())
+		return growthMeet<int64_t>(op);
+	return growthMeet<APInt>(op);
+}
 
-	APInt oLower = op->getSink()->getRange().getLower();
-	APInt oUpper = op->getSink()->getRange().getUpper();
+template<class B>
+static bool narrowMeet(BasicOp* op) {
+	typedef Bounds<B> T;
+	B oLower = T::lower(op->getSink()->getRange());
+	B oUpper = T::upper(op->getSink()->getRange());
 	Range newInterval = op->eval();
 
-	APInt nLower = newInterval.getLower();
-	APInt nUpper = newInterval.getUpper();
+	B nLower = T::lower(newInterval);
+	B nUpper = T::upper(newInterval);
 	
 	bool hasChanged = false;
 
-	if (oLower.eq(Min) && nLower.ne(Min)) {
+	if (oLower == T::min() && nLower != T::min()) {
 		op->getSink()->setRange(Range(nLower, oUpper));
 		hasChanged = true;
 	} else {
-		APInt smin = APIntOps::smin(oLower, nLower);
-		if (oLower.ne(smin)) {
+		B smin = T::slt(nLower, oLower) ? nLower : oLower;
+		if (oLower != smin) {
 			op->getSink()->setRange(Range(smin, oUpper));
 			hasChanged = true;
 		}
 	}
 
-	if (oUpper.eq(Max) && nUpper.ne(Max)) {
-		op->getSink()->setRange(Range(op->getSink()->getRange().getLower(), nUpper));
+	if (oUpper == T::max() && nUpper != T::max()) {
+		op->getSink()->setRange(Range(T::lower(op->getSink()->getRange()), nUpper));
 		hasChanged = true;
 	} else {
-		APInt smax = APIntOps::smax(oUpper, nUpper);
-		if (oUpper.ne(smax)) {
-			op->getSink()->setRange(Range(op->getSink()->getRange().getLower(), smax));
+		B smax = T::slt(oUpper, nUpper) ? nUpper : oUpper;
+		if (oUpper != smax) {
+			op->getSink()->setRange(Range(T::lower(op->getSink()->getRange()), smax));
 			hasChanged = true;
 		}
 	}
-	
-	//errs() << "final> " << op->getSink()->getValue()->getName() << " [" << op->getSink()->getRange().getLower() << ", " << op->getSink()->getRange().getUpper() << "]\n";
-	// dbgs() << "NARROW::" << op->getSink()->getValue()->getName() << ": " << Range(oLower,oUpper) << " -> " << op->getSink()->getRange() << "\n";
+
 	return hasChanged;
 }
 
-bool Meet::crop(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
+/// This is the meet operator of the cropping analysis. Whereas the growth
+/// analysis expands the bounds of each variable, regardless of intersections
+/// in the constraint graph, the cropping analysis shrinks these bounds back
+/// to ranges that respect the intersections.
+bool Meet::narrow(BasicOp* op, const JumpSet *jumpset) {
+	if (Range::fitsWord())
+		return narrowMeet<int64_t>(op);
+	return narrowMeet<APInt>(op);
+}
+
+template<class B>
+static bool cropMeet(BasicOp* op) {
+	typedef Bounds<B> T;
 	Range oldInterval = op->getSink()->getRange();
 	Range newInterval = op->eval();
 
@@ -2712,17 +3777,17 @@ bool Meet::crop(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
 	char abstractState = op->getSink()->getAbstractState();
 
 	if ((abstractState == '-' || abstractState == '?')
-			&& newInterval.getLower().sgt(oldInterval.getLower())) {
+			&& T::slt(T::lower(oldInterval), T::lower(newInterval))) {
 		op->getSink()->setRange(
-				Range(newInterval.getLower(), oldInterval.getUpper()));
+				Range(T::lower(newInterval), T::upper(oldInterval)));
 		hasChanged = true;
 	}
 
 	if ((abstractState == '+' || abstractState == '?')
-			&& newInterval.getUpper().slt(oldInterval.getUpper())) {
+			&& T::slt(T::upper(newInterval), T::upper(oldInterval))) {
 		op->getSink()->setRange(
-				Range(op->getSink()->getRange().getLower(),
-						newInterval.getUpper()));
+				Range(T::lower(op->getSink()->getRange()),
+						T::upper(newInterval)));
 		hasChanged = true;
 	}
 
@@ -2730,25 +3795,35 @@ bool Meet::crop(BasicOp* op, const SmallVector<APInt, 2> *constantvector) {
 	return hasChanged;
 }
 
+bool Meet::crop(BasicOp* op, const JumpSet *jumpset) {
+	if (Range::fitsWord())
+		return cropMeet<int64_t>(op);
+	return cropMeet<APInt>(op);
+}
+
 void Cousot::preUpdate(const UseMap &compUseMap,
-		SmallPtrSet<const Value*, 6>& entryPoints) {
-	update(compUseMap, entryPoints, Meet::widen);
+		SmallPtrSet<const Value*, 6>& entryPoints,
+		const JumpSet &jumpset) {
+	update(compUseMap, entryPoints, Meet::widen, jumpset);
 }
 
 void Cousot::posUpdate(const UseMap &compUseMap,
 		SmallPtrSet<const Value*, 6>& entryPoints,
-		const SmallPtrSet<VarNode*, 32> *component) {
-	update(compUseMap, entryPoints, Meet::narrow);
+		const SmallPtrSet<VarNode*, 32> *component,
+		const JumpSet &jumpset) {
+	update(compUseMap, entryPoints, Meet::narrow, jumpset);
 }
 
 void CropDFS::preUpdate(const UseMap &compUseMap,
-		SmallPtrSet<const Value*, 6>& entryPoints) {
-	update(compUseMap, entryPoints, Meet::growth);
+		SmallPtrSet<const Value*, 6>& entryPoints,
+		const JumpSet &jumpset) {
+	update(compUseMap, entryPoints, Meet::growth, jumpset);
 }
 
 void CropDFS::posUpdate(const UseMap &compUseMap,
 		SmallPtrSet<const Value*, 6>& entryPoints,
-		const SmallPtrSet<VarNode*, 32> *component) {
+		const SmallPtrSet<VarNode*, 32> *component,
+		const JumpSet &jumpset) {
 	storeAbstractStates(component);
 	GenOprs::iterator obgn = oprs.begin(), oend = oprs.end();
 	for (; obgn != oend; ++obgn) {
@@ -2756,9 +3831,7 @@ void CropDFS::posUpdate(const UseMap &compUseMap,
 
 		if (component->count(op->getSink()))
 			//int_op
-			if (isa<UnaryOp>(op)
-					&& (op->getSink()->getRange().getLower().ne(Min)
-							|| op->getSink()->getRange().getUpper().ne(Max)))
+			if (isa<UnaryOp>(op) && !op->getSink()->getRange().isMaxRange())
 				crop(compUseMap, op);
 	}
 }
@@ -2766,6 +3839,7 @@ void CropDFS::posUpdate(const UseMap &compUseMap,
 void CropDFS::crop(const UseMap &compUseMap, BasicOp *op) {
 	SmallPtrSet<BasicOp*, 8> activeOps;
 	SmallPtrSet<const VarNode*, 8> visitedOps;
+	uint64_t meets = 0;
 
 	//init the activeOps only with the op received
 	activeOps.insert(op);
@@ -2780,6 +3854,7 @@ void CropDFS::crop(const UseMap &compUseMap, BasicOp *op) {
 			continue;
 
 		Meet::crop(V, NULL);
+		++meets;
 		visitedOps.insert(sink);
 
 		// The use list.of sink
@@ -2791,21 +3866,82 @@ void CropDFS::crop(const UseMap &compUseMap, BasicOp *op) {
 			activeOps.insert(*bgn);
 		}
 	}
+
+	// The narrowing of CropDFS is this crop, not Meet::narrow
+	if (profiling())
+		prof->addCount("NarrowMeets", meets);
+}
+
+/*
+ *	Numbers the variables of a component in reverse postorder of the uses in
+ *	compUseMap, starting the search from the variables in roots. The
+ *	worklist of update takes variables in this order, so that in each round
+ *	a variable is usually evaluated after the ones that feed it.
+ */
+static void numberInRPO(const UseMap &compUseMap,
+		const SmallPtrSet<const Value*, 6> &roots,
+		DenseMap<const Value*, unsigned> &order,
+		std::vector<const Value*> &byOrder) {
+	typedef std::pair<const Value*, SmallPtrSetIterator<BasicOp*> > Frame;
+	std::vector<const Value*> postorder;
+	SmallPtrSet<const Value*, 32> visited;
+	std::vector<Frame> stack;
+
+	// Roots first, then whatever they do not reach
+	std::vector<const Value*> starts(roots.begin(), roots.end());
+	for (UseMap::const_iterator umit = compUseMap.begin(), umend =
+			compUseMap.end(); umit != umend; ++umit) {
+		starts.push_back(umit->first);
+	}
+
+	for (std::vector<const Value*>::iterator rit = starts.begin(), rend =
+			starts.end(); rit != rend; ++rit) {
+		if (!visited.insert(*rit))
+			continue;
+		stack.push_back(Frame(*rit, compUseMap.find(*rit)->second.begin()));
+
+		while (!stack.empty()) {
+			const Value *V = stack.back().first;
+			if (stack.back().second == compUseMap.find(V)->second.end()) {
+				postorder.push_back(V);
+				stack.pop_back();
+				continue;
+			}
+
+			const Value *S = (*stack.back().second)->getSink()->getValue();
+			++stack.back().second;
+			if (visited.insert(S))
+				stack.push_back(Frame(S, compUseMap.find(S)->second.begin()));
+		}
+	}
+
+	byOrder.assign(postorder.rbegin(), postorder.rend());
+	for (unsigned i = 0, e = byOrder.size(); i < e; ++i) {
+		order[byOrder[i]] = i;
+	}
 }
 
 void ConstraintGraph::update(const UseMap &compUseMap,
-		SmallPtrSet<const Value*, 6>& actv, bool(*meet)(BasicOp* op, const SmallVector<APInt, 2> *constantvector)) {
-	/* Breaks during narrowing. */
-	/* dbgs() << "actv = " << "{ ";
-	for (SmallPtrSetIterator<const Value*> i = actv.begin(), e = actv.end(); i != e; ++i) { 
-		dbgs() << " " << **i;
-	}
-	dbgs() << "};\n";
-	*/
-	while (!actv.empty()) {
-		const Value* V = *actv.begin();
-                // dbgs() << "const Value* V = " << **actv.begin() << ";\n";
-		actv.erase(V);
+		SmallPtrSet<const Value*, 6>& actv, bool(*meet)(BasicOp* op, const JumpSet *jumpset),
+		const JumpSet &jumpset) {
+	DenseMap<const Value*, unsigned> order;
+	std::vector<const Value*> byOrder;
+	numberInRPO(compUseMap, actv, order, byOrder);
+
+	// The active variables, lowest reverse postorder number first
+	std::set<unsigned> worklist;
+	for (SmallPtrSetIterator<const Value*> ait = actv.begin(), aend =
+			actv.end(); ait != aend; ++ait) {
+		worklist.insert(order[*ait]);
+	}
+	actv.clear();
+
+	// How many times the meet operator was applied
+	uint64_t meets = 0;
+
+	while (!worklist.empty()) {
+		const Value* V = byOrder[*worklist.begin()];
+		worklist.erase(worklist.begin());
 		
 #ifdef STATS
 		// Updates Fermap
@@ -2814,26 +3950,22 @@ void ConstraintGraph::update(const UseMap &compUseMap,
 		}
 #endif
 
-		//errs() << "Update: " << V->getName() << "\n";
 		// The use list.
 		const SmallPtrSet<BasicOp*, 8> &L = compUseMap.find(V)->second;
-		/* dbgs() << "compUseMap = " << "{ ";
-		for (SmallPtrSetIterator<BasicOp*> i = L.begin(), e = L.end(); i != e; ++i) { 
-			dbgs() << " " << *(*i)->getSink()->getValue();
-		}
-		dbgs() << "};\n";
-		*/
 		SmallPtrSetIterator<BasicOp*> bgn = L.begin(), end = L.end();
+		meets += L.size();
 
 		for (; bgn != end; ++bgn) {
-			if (meet(*bgn, &constantvector)) {
-				// I want to use it as a set, but I also want
-				// keep an order or insertions and removals.
-               			// dbgs() << "actv.insert(" << *(*bgn)->getSink()->getValue() << ");\n";
-				actv.insert((*bgn)->getSink()->getValue());
+			if (meet(*bgn, &jumpset)) {
+				worklist.insert(order[(*bgn)->getSink()->getValue()]);
 			}
 		}
 	}
+
+	if (profiling()) {
+		bool narrowing = meet == Meet::narrow || meet == Meet::crop;
+		prof->addCount(narrowing ? "NarrowMeets" : "WidenMeets", meets);
+	}
 }
 
 void ConstraintGraph::update(unsigned nIterations, const UseMap &compUseMap,
@@ -2858,116 +3990,618 @@ void ConstraintGraph::update(unsigned nIterations, const UseMap &compUseMap,
 void ConstraintGraph::findIntervals() {
 //	clearValueMaps();
 
-	// Builds symbMap
-#ifdef STATS
-	Profile::TimeValue before = prof.timenow();
+#ifdef JUMPSET
+	// The jump-set thresholds of every SCC, sorted once
+	buildThresholds();
 #endif
+
+	// Builds symbMap
+	Profile::TimeValue before;
+	if (profiling())
+		before = prof->timenow();
 	buildSymbolicIntersectMap();
 
 	// List of SCCs
 	Nuutila sccList(&vars, &useMap, &symbMap);
-#ifdef STATS
-	Profile::TimeValue after = prof.timenow();
-	Profile::TimeValue elapsed = after - before;
-	prof.updateTime("Nuutila", elapsed);
-#endif
+	if (profiling()) {
+		prof->updateTime("Nuutila", prof->timenow() - before);
+		prof->addCount("Variables", vars.size());
+		prof->addCount("Operations", oprs.size());
+		prof->addCount("SCCs", sccList.worklist.size());
+	}
 	// STATS
 	numSCCs += sccList.worklist.size();
 #ifdef SCC_DEBUG
 	unsigned numberOfSCCs = numSCCs;
 #endif
 
-	// For each SCC in graph, do the following
-#ifdef STATS
-	before = prof.timenow();
-#endif
-	
+	// The components in topological order
+	ComponentList components;
 	for (Nuutila::iterator nit = sccList.begin(), nend = sccList.end();
 			nit != nend; ++nit) {
-		SmallPtrSet<VarNode*, 32> &component = *sccList.components[*nit];
+		SmallPtrSet<VarNode*, 32> *component = sccList.components[*nit];
+		components.push_back(component);
 #ifdef SCC_DEBUG
 		--numberOfSCCs;
 #endif
-		//PRINTCOMPONENT(component)
 
-		if (component.size() == 1) {
+		if (component->size() == 1) {
 			++numAloneSCCs;
-			fixIntersects(component);
-			
-			VarNode *var = *component.begin();
-			if (var->getRange().isUnknown()) {
-				var->setRange(Range(Min, Max));
-			}
-		}else{
-			if (component.size() > sizeMaxSCC) {
-				sizeMaxSCC = component.size();
-			}
+		} else if (component->size() > sizeMaxSCC) {
+			sizeMaxSCC = component->size();
+		}
+		if (profiling())
+			prof->updateMax("SCCSize", component->size());
+	}
 
-			UseMap compUseMap = buildUseMap(component);
+	// For each SCC in graph, do the following
+	if (profiling())
+		before = prof->timenow();
 
-			// Get the entry points of the SCC
-			SmallPtrSet<const Value*, 6> entryPoints;
-			
-#ifdef JUMPSET
-			// Create vector of constants inside component
-			// Comment this line below to deactivate jump-set
-			buildConstantVector(component, compUseMap);
+	unsigned nThreads = raThreads;
+#if defined(STATS) || defined(PRINT_DEBUG)
+	// FerMap and the dot dumps are not thread safe
+	nThreads = 1;
 #endif
+	// Neither is the profile, and the timings are of the whole process
+	if (profiling())
+		nThreads = 1;
 
-			//generateEntryPoints(component, entryPoints);
-			//iterate a fixed number of time before widening
-			//update(component.size()*2 /*| NUMBER_FIXED_ITERATIONS*/, compUseMap, entryPoints);
+	solveComponents(components, nThreads);
 
-#ifdef PRINT_DEBUG
-			if (func)
-				printToFile(*func, "/tmp/" + func->getName() + "cgfixed.dot");
+	if (profiling())
+		prof->updateTime("SCCs resolution", prof->timenow() - before);
+
+#ifdef SCC_DEBUG
+	ASSERT(numberOfSCCs==0, "Not all SCCs have been visited")
 #endif
-			
-			// Primeiro iterate till fix point
-			generateEntryPoints(component, entryPoints);
-			// Primeiro iterate till fix point
-			preUpdate(compUseMap, entryPoints);
-			fixIntersects(component);
-			
-			// FIXME: Ensure that this code is not needed
-			for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend = component.end(); cit != cend; ++cit) {
-				VarNode* var = *cit;
-				
-				if (var->getRange().isUnknown()) {
-					var->setRange(Range(Min, Max));
-				}
+
+#ifdef STATS
+	before = prof->timenow();
+	computeStats();
+	prof->updateTime("ComputeStats", prof->timenow() - before);
+#endif
+}
+
+// Whether the integers of I fit in the width the graph was built with
+static bool fitsGraphWidth(const Instruction *I) {
+	if (const IntegerType *ty = dyn_cast<IntegerType>(I->getType())) {
+		if (ty->getBitWidth() > MAX_BIT_INT)
+			return false;
+	}
+
+	for (User::const_op_iterator it = I->op_begin(), e = I->op_end(); it != e;
+			++it) {
+		const IntegerType *ty = dyn_cast<IntegerType>((*it)->getType());
+		if (ty && ty->getBitWidth() > MAX_BIT_INT)
+			return false;
+	}
+
+	return true;
+}
+
+void ConstraintGraph::addValue(const Instruction *I) {
+	const Type* ty = I->getType();
+	if (!(ty->isIntegerTy() || ty->isPointerTy() || ty->isVoidTy())) {
+		return;
+	}
+
+	// Already in the graph, or wider than its APInts
+	if (!isValidInstruction(I) || defMap.count(I) || !fitsGraphWidth(I)) {
+		return;
+	}
+
+	// A new sigma may hang from a branch that was not there when the graph
+	// was built
+	const PHINode *Phi = dyn_cast<PHINode>(I);
+	if (Phi && Phi->getName().startswith(sigmaString)
+			&& Phi->getNumIncomingValues() > 0) {
+		const Value *operand = Phi->getIncomingValue(0);
+
+		if (!valuesBranchMap.count(operand) && !valuesSwitchMap.count(operand)) {
+			const TerminatorInst *ti = Phi->getIncomingBlock(0)->getTerminator();
+
+			if (const BranchInst *br = dyn_cast<BranchInst>(ti)) {
+				buildValueBranchMap(br);
+			} else if (const SwitchInst *sw = dyn_cast<SwitchInst>(ti)) {
+				buildValueSwitchMap(sw);
 			}
+		}
+	}
 
-			//printResultIntervals();
-#ifdef PRINT_DEBUG
-			if (func)
-				printToFile(*func, "/tmp/" + func->getName() + "cgint.dot");
+	buildOperations(I);
+	DefMap::iterator dit = defMap.find(I);
+	if (dit != defMap.end()) {
+		addSymbolicIntersect(dit->second);
+	}
+	changedValues.insert(I);
+}
+
+// The variables that op reads, not counting the bound of its intersect
+static void getOperationSources(const BasicOp *op,
+		SmallVectorImpl<const VarNode*> &sources) {
+	if (const UnaryOp *uop = dyn_cast<UnaryOp>(op)) {
+		sources.push_back(uop->getSource());
+	} else if (const BinaryOp *bop = dyn_cast<BinaryOp>(op)) {
+		sources.push_back(bop->getSource1());
+		sources.push_back(bop->getSource2());
+	} else if (const PhiOp *pop = dyn_cast<PhiOp>(op)) {
+		for (unsigned i = 0, e = pop->getNumSources(); i < e; ++i) {
+			sources.push_back(pop->getSource(i));
+		}
+	}
+}
+
+void ConstraintGraph::addSymbolicIntersect(BasicOp *op) {
+	UnaryOp *uop = dyn_cast<UnaryOp>(op);
+	if (uop && isa<SymbInterval>(uop->getIntersect())) {
+		symbMap[cast<SymbInterval>(uop->getIntersect())->getBound()].insert(uop);
+	}
+}
+
+void ConstraintGraph::removeSymbolicIntersect(BasicOp *op) {
+	UnaryOp *uop = dyn_cast<UnaryOp>(op);
+	if (!uop || !isa<SymbInterval>(uop->getIntersect())) {
+		return;
+	}
+
+	SymbMap::iterator sit = symbMap.find(
+			cast<SymbInterval>(uop->getIntersect())->getBound());
+	if (sit != symbMap.end()) {
+		sit->second.erase(uop);
+		if (sit->second.empty()) {
+			symbMap.erase(sit);
+		}
+	}
+}
+
+void ConstraintGraph::removeValue(const Value *V) {
+	if (!vars.count(V)) {
+		return;
+	}
+
+	// The operation that defines V no longer uses its sources
+	DefMap::iterator dit = defMap.find(V);
+	if (dit != defMap.end()) {
+		BasicOp *op = dit->second;
+		SmallVector<const VarNode*, 2> sources;
+		getOperationSources(op, sources);
+
+		for (SmallVectorImpl<const VarNode*>::iterator sit = sources.begin(),
+				send = sources.end(); sit != send; ++sit) {
+			UseMap::iterator uit = useMap.find((*sit)->getValue());
+			if (uit != useMap.end()) {
+				uit->second.erase(op);
+			}
+		}
+
+		removeSymbolicIntersect(op);
+		defMap.erase(dit);
+		oprs.erase(op);
+		removedOprs.push_back(op);
+	}
+
+	// Whether V is still needed is only known once every removal is done
+	changedValues.insert(V);
+	removedValues.insert(V);
+}
+
+/*
+ *	Takes out of the graph the removed values that no operation uses or is
+ *	bounded by anymore. The operations that still use the others, or are
+ *	bounded by them, see them as inputs from now on.
+ */
+void ConstraintGraph::dropRemovedValues() {
+	for (SmallPtrSetIterator<const Value*> rit = removedValues.begin(), rend =
+			removedValues.end(); rit != rend; ++rit) {
+		const Value *V = *rit;
+		VarNodes::iterator vit = vars.find(V);
+		if (vit == vars.end()) {
+			continue;
+		}
+
+		UseMap::iterator uit = useMap.find(V);
+		bool used = uit != useMap.end() && !uit->second.empty();
+		// Also kept if addValue has defined it again
+		if (used || symbMap.count(V) || defMap.count(V)) {
+			continue;
+		}
+
+		changedValues.erase(V);
+		if (uit != useMap.end()) {
+			useMap.erase(uit);
+		}
+		removedVars.push_back(vit->second);
+		vars.erase(vit);
+	}
+	removedValues.clear();
+}
+
+/*
+ *	Solves again the SCCs whose variables are reached, through uses or
+ *	futures, from the values added and removed since the last solve. The
+ *	other SCCs keep their ranges; they are only evaluated into the first
+ *	SCCs that are solved again, as propagateToNextSCC would do. The reached
+ *	variables are closed under uses and futures, so an SCC holding one of
+ *	them holds only such variables, and the SCCs are found among these
+ *	alone. symbMap is kept up to date by addValue and removeValue.
+ */
+void ConstraintGraph::resolve() {
+	if (changedValues.empty()) {
+		return;
+	}
+
+	Profile::TimeValue before;
+	if (profiling())
+		before = prof->timenow();
+
+	// The new variables that no operation defines are inputs
+	for (SmallVectorImpl<const Value*>::iterator nit = newVars.begin(), nend =
+			newVars.end(); nit != nend; ++nit) {
+		VarNodes::iterator vit = vars.find(*nit);
+		if (vit != vars.end() && vit->second->getRange().isUnknown()
+				&& !defMap.count(vit->first)) {
+			vit->second->init(true);
+		}
+	}
+	newVars.clear();
+
+	// The variables that the changes reach
+	SmallPtrSet<const Value*, 64> affected;
+	SmallVector<const Value*, 16> worklist(changedValues.begin(),
+			changedValues.end());
+	changedValues.clear();
+
+	while (!worklist.empty()) {
+		const Value *V = worklist.pop_back_val();
+		if (!vars.count(V) || !affected.insert(V)) {
+			continue;
+		}
+
+		UseMap::iterator uit = useMap.find(V);
+		if (uit != useMap.end()) {
+			for (SmallPtrSetIterator<BasicOp*> opit = uit->second.begin(),
+					opend = uit->second.end(); opit != opend; ++opit) {
+				worklist.push_back((*opit)->getSink()->getValue());
+			}
+		}
+
+		SymbMap::iterator sit = symbMap.find(V);
+		if (sit != symbMap.end()) {
+			for (SmallPtrSetIterator<BasicOp*> opit = sit->second.begin(),
+					opend = sit->second.end(); opit != opend; ++opit) {
+				worklist.push_back((*opit)->getSink()->getValue());
+			}
+		}
+	}
+
+#ifdef JUMPSET
+	updateThresholds(affected);
 #endif
 
-			// Segundo iterate till fix point
-			SmallPtrSet<const Value*, 6> activeVars;
-			generateActivesVars(component, activeVars);
-                        /* Loop starts here. */
-			posUpdate(compUseMap, activeVars, &component);
+	// Their ranges are found from scratch
+	VarNodes affectedVars;
+	SymbMap affectedSymbMap;
+	for (SmallPtrSetIterator<const Value*> ait = affected.begin(), aend =
+			affected.end(); ait != aend; ++ait) {
+		VarNode *var = vars.find(*ait)->second;
+		var->init(!defMap.count(*ait));
+		affectedVars.insert(std::make_pair(*ait, var));
+
+		SymbMap::iterator sit = symbMap.find(*ait);
+		if (sit != symbMap.end()) {
+			affectedSymbMap.insert(*sit);
+		}
+	}
+
+	// Only the operations that read the other SCCs need their ranges again
+	for (SmallPtrSetIterator<const Value*> ait = affected.begin(), aend =
+			affected.end(); ait != aend; ++ait) {
+		DefMap::iterator dit = defMap.find(*ait);
+		if (dit == defMap.end()) {
+			continue;
+		}
+
+		BasicOp *op = dit->second;
+		SmallVector<const VarNode*, 2> sources;
+		getOperationSources(op, sources);
+
+		bool readsKept = false;
+		for (SmallVectorImpl<const VarNode*>::iterator sit = sources.begin(),
+				send = sources.end(); sit != send && !readsKept; ++sit) {
+			readsKept = !affected.count((*sit)->getValue());
+		}
+		if (!readsKept) {
+			continue;
 		}
+
+		SigmaOp *sigmaop = dyn_cast<SigmaOp>(op);
+
+		op->getSink()->setRange(op->eval());
+
+		if (sigmaop && sigmaop->getIntersect()->getRange().isUnknown()) {
+			sigmaop->markUnresolved();
+		}
+	}
+
+	Nuutila sccList(&affectedVars, &useMap, &affectedSymbMap);
+	unsigned resolved = 0;
+
+	for (Nuutila::iterator nit = sccList.begin(), nend = sccList.end();
+			nit != nend; ++nit) {
+		SmallPtrSet<VarNode*, 32> &component = *sccList.components[*nit];
+		solveComponent(component);
 		propagateToNextSCC(component);
+		++resolved;
 	}
 
-#ifdef STATS
-	elapsed = prof.timenow() - before;
-	prof.updateTime("SCCs resolution", elapsed);
+	if (profiling()) {
+		prof->updateTime("Incremental resolution", prof->timenow() - before);
+		prof->addCount("ResolvedSCCs", resolved);
+	}
+}
+
+void ConstraintGraph::solveComponent(SmallPtrSet<VarNode*, 32> &component) {
+	//PRINTCOMPONENT(component)
+
+	if (component.size() == 1) {
+		fixIntersects(component);
+		
+		VarNode *var = *component.begin();
+		if (var->getRange().isUnknown()) {
+			var->setRange(Range(Min, Max));
+		}
+		return;
+	}
+
+	UseMap compUseMap = buildUseMap(component);
+
+	// Get the entry points of the SCC
+	SmallPtrSet<const Value*, 6> entryPoints;
+	
+	// The constants of the component
+	JumpSet jumpset(thresholds);
+
+#ifdef JUMPSET
+	// Look up the constants of the component in the index
+	// Comment this line below to deactivate jump-set
+	buildJumpSet(component, compUseMap, jumpset);
 #endif
 
-#ifdef SCC_DEBUG
-	ASSERT(numberOfSCCs==0, "Not all SCCs have been visited")
+	//generateEntryPoints(component, entryPoints);
+	//iterate a fixed number of time before widening
+	//update(component.size()*2 /*| NUMBER_FIXED_ITERATIONS*/, compUseMap, entryPoints);
+
+#ifdef PRINT_DEBUG
+	if (func)
+		printToFile(*func, "/tmp/" + func->getName() + "cgfixed.dot");
 #endif
+	
+	// The meets of this SCC are the growth of the counters
+	uint64_t widenMeets = 0, narrowMeets = 0;
+	if (profiling()) {
+		widenMeets = prof->getCount("WidenMeets");
+		narrowMeets = prof->getCount("NarrowMeets");
+	}
+
+	// Primeiro iterate till fix point
+	generateEntryPoints(component, entryPoints);
+	// Primeiro iterate till fix point
+	preUpdate(compUseMap, entryPoints, jumpset);
+	fixIntersects(component);
+	
+	// FIXME: Ensure that this code is not needed
+	for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend = component.end(); cit != cend; ++cit) {
+		VarNode* var = *cit;
+		
+		if (var->getRange().isUnknown()) {
+			var->setRange(Range(Min, Max));
+		}
+	}
 
-#ifdef STATS
-	before = prof.timenow();
-	computeStats();
-	elapsed = prof.timenow() - before;
-	prof.updateTime("ComputeStats", elapsed);
+	//printResultIntervals();
+#ifdef PRINT_DEBUG
+	if (func)
+		printToFile(*func, "/tmp/" + func->getName() + "cgint.dot");
 #endif
+
+	// Segundo iterate till fix point
+	SmallPtrSet<const Value*, 6> activeVars;
+	generateActivesVars(component, activeVars);
+	/* Loop starts here. */
+	posUpdate(compUseMap, activeVars, &component, jumpset);
+
+	if (profiling()) {
+		prof->updateMax("WidenMeetsPerSCC",
+				prof->getCount("WidenMeets") - widenMeets);
+		prof->updateMax("NarrowMeetsPerSCC",
+				prof->getCount("NarrowMeets") - narrowMeets);
+	}
+}
+
+/*
+ *	The state shared by the threads of solveComponents. A component becomes
+ *	ready when all the components it depends on are solved; ready components
+ *	are taken lowest topological index first.
+ */
+struct SCCSchedule {
+	ConstraintGraph *CG;
+	const ComponentList *components;
+	// The operations that feed each component from the components before
+	// it, ordered by the topological index of their source component
+	std::vector<std::vector<BasicOp*> > incoming;
+	// The operations whose source and sink are in the same component
+	std::vector<std::vector<BasicOp*> > internal;
+	std::vector<std::vector<unsigned> > succs;
+	// How many predecessors of each component are not solved yet
+	std::vector<unsigned> waiting;
+	std::set<unsigned> ready;
+	unsigned unsolved;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
+
+void* ConstraintGraph::solveWorker(void *arg) {
+	SCCSchedule *S = (SCCSchedule*) arg;
+
+	pthread_mutex_lock(&S->lock);
+	while (true) {
+		while (S->ready.empty() && S->unsolved > 0)
+			pthread_cond_wait(&S->changed, &S->lock);
+		if (S->unsolved == 0)
+			break;
+
+		unsigned i = *S->ready.begin();
+		S->ready.erase(S->ready.begin());
+		pthread_mutex_unlock(&S->lock);
+
+		S->CG->evalOperations(S->incoming[i]);
+		S->CG->solveComponent(*(*S->components)[i]);
+		S->CG->evalOperations(S->internal[i]);
+
+		pthread_mutex_lock(&S->lock);
+		--S->unsolved;
+		for (std::vector<unsigned>::iterator sit = S->succs[i].begin(), send =
+				S->succs[i].end(); sit != send; ++sit) {
+			if (--S->waiting[*sit] == 0)
+				S->ready.insert(*sit);
+		}
+		pthread_cond_broadcast(&S->changed);
+	}
+	pthread_mutex_unlock(&S->lock);
+
+	return NULL;
+}
+
+/*
+ *	Solves the SCCs, given in topological order, on nThreads threads.
+ *	Instead of pushing its ranges forward with propagateToNextSCC, each
+ *	component pulls them from its predecessors right before it is solved,
+ *	and evaluates once more the operations that stay inside it right after.
+ *	The operations are grouped by the component of their sink in a single
+ *	pass over the uses, already in the order in which propagateToNextSCC
+ *	would evaluate them.
+ *
+ *	Components that do not depend on each other, through uses or through
+ *	the futures of symbolic intervals, are solved at the same time. No
+ *	thread writes the nodes of another component, so the result does not
+ *	depend on the number of threads or on their timing; with one thread the
+ *	components are solved in topological order.
+ */
+void ConstraintGraph::solveComponents(const ComponentList &components,
+		unsigned nThreads) {
+	unsigned n = components.size();
+
+	DenseMap<const VarNode*, unsigned> index;
+	for (unsigned i = 0; i < n; ++i) {
+		for (SmallPtrSetIterator<VarNode*> cit = components[i]->begin(), cend =
+				components[i]->end(); cit != cend; ++cit) {
+			index[*cit] = i;
+		}
+	}
+
+	SCCSchedule S;
+	S.CG = this;
+	S.components = &components;
+	S.incoming.resize(n);
+	S.internal.resize(n);
+
+	// Edges of the condensation of the graph
+	std::vector<std::set<unsigned> > predSets(n);
+	for (unsigned i = 0; i < n; ++i) {
+		for (SmallPtrSetIterator<VarNode*> cit = components[i]->begin(), cend =
+				components[i]->end(); cit != cend; ++cit) {
+			const SmallPtrSet<BasicOp*, 8> &uses =
+					this->useMap.find((*cit)->getValue())->second;
+			for (SmallPtrSetIterator<BasicOp*> sit = uses.begin(), send =
+					uses.end(); sit != send; ++sit) {
+				unsigned j = index[(*sit)->getSink()];
+				if (j == i) {
+					S.internal[i].push_back(*sit);
+				} else {
+					S.incoming[j].push_back(*sit);
+					predSets[j].insert(i);
+				}
+			}
+		}
+	}
+
+	if (nThreads <= 1) {
+		for (unsigned i = 0; i < n; ++i) {
+			evalOperations(S.incoming[i]);
+			solveComponent(*components[i]);
+			evalOperations(S.internal[i]);
+		}
+		return;
+	}
+
+	for (SymbMap::iterator sit = symbMap.begin(), send = symbMap.end();
+			sit != send; ++sit) {
+		VarNodes::iterator bound = this->vars.find(sit->first);
+		if (bound == this->vars.end())
+			continue;
+
+		unsigned i = index[bound->second];
+		for (SmallPtrSetIterator<BasicOp*> opit = sit->second.begin(), opend =
+				sit->second.end(); opit != opend; ++opit) {
+			unsigned j = index[(*opit)->getSink()];
+			if (j != i)
+				predSets[j].insert(i);
+		}
+	}
+
+	S.succs.resize(n);
+	S.waiting.resize(n);
+	S.unsolved = n;
+
+	for (unsigned j = 0; j < n; ++j) {
+		for (std::set<unsigned>::iterator pit = predSets[j].begin(), pend =
+				predSets[j].end(); pit != pend; ++pit) {
+			S.succs[*pit].push_back(j);
+		}
+		S.waiting[j] = predSets[j].size();
+		if (S.waiting[j] == 0)
+			S.ready.insert(j);
+	}
+
+	pthread_mutex_init(&S.lock, NULL);
+	pthread_cond_init(&S.changed, NULL);
+
+	if (nThreads > n)
+		nThreads = n;
+
+	std::vector<pthread_t> threads(nThreads > 1 ? nThreads - 1 : 0);
+	unsigned nStarted = 0;
+	for (; nStarted < threads.size(); nStarted++) {
+		if (pthread_create(&threads[nStarted], NULL, solveWorker, &S))
+			break;
+	}
+
+	// The calling thread works too, and finishes the job alone if no thread could be started
+	solveWorker(&S);
+
+	for (unsigned i = 0; i < nStarted; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&S.changed);
+	pthread_mutex_destroy(&S.lock);
+}
+
+/*
+ *	Evaluates each operation once, in order, as propagateToNextSCC does.
+ */
+void ConstraintGraph::evalOperations(const std::vector<BasicOp*> &ops) {
+	for (std::vector<BasicOp*>::const_iterator oit = ops.begin(), oend =
+			ops.end(); oit != oend; ++oit) {
+		BasicOp *op = *oit;
+		SigmaOp *sigmaop = dyn_cast<SigmaOp>(op);
+
+		op->getSink()->setRange(op->eval());
+
+		if (sigmaop && sigmaop->getIntersect()->getRange().isUnknown()) {
+			sigmaop->markUnresolved();
+		}
+	}
 }
 
 void ConstraintGraph::generateEntryPoints(SmallPtrSet<VarNode*, 32> &component
@@ -3009,6 +4643,11 @@ void ConstraintGraph::generateEntryPoints(SmallPtrSet<VarNode*, 32> &component
 }
 
 void ConstraintGraph::fixIntersects(SmallPtrSet<VarNode*, 32> &component) {
+	// Only components that bound some future are timed
+	Profile::TimeValue before;
+	bool timed = false;
+	unsigned fixed = 0;
+
 	// Iterate again over the varnodes in the component
 	for (SmallPtrSetIterator<VarNode*> cit = component.begin(), cend =
 			component.end(); cit != cend; ++cit) {
@@ -3018,14 +4657,25 @@ void ConstraintGraph::fixIntersects(SmallPtrSet<VarNode*, 32> &component) {
 		SymbMap::iterator sit = symbMap.find(V);
 
 		if (sit != symbMap.end()) {
+			if (!timed && profiling()) {
+				before = prof->timenow();
+				timed = true;
+			}
+
 			for (SmallPtrSetIterator<BasicOp*> opit = sit->second.begin(),
 					opend = sit->second.end(); opit != opend; ++opit) {
 				BasicOp *op = *opit;
 
 				op->fixIntersects(var);
+				++fixed;
 			}
 		}
 	}
+
+	if (timed) {
+		prof->updateTime("Futures resolution", prof->timenow() - before);
+		prof->addCount("Futures", fixed);
+	}
 }
 
 void ConstraintGraph::generateActivesVars(SmallPtrSet<VarNode*, 32> &component
@@ -3423,6 +5073,7 @@ void Nuutila::delControlDependenceEdges(UseMap *useMap) {
 
 			// Remove pseudo edge from the map
 			it->second.erase(op);
+			delete op;
 		}
 	}
 }
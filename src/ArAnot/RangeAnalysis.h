@@ -42,6 +42,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ConstantRange.h"
@@ -53,8 +54,11 @@
 #include <deque>
 #include <stack>
 #include <set>
+#include <map>
 #include <sstream>
 #include <algorithm>
+#include <vector>
+#include <new>
 
 //TODO: comment the line below to disable the debug of SCCs and optimize the code
 // generated.
@@ -134,20 +138,52 @@ using namespace llvm;
 
 enum RangeType {Unknown, Regular, Empty};
 
+// The widest integer of the function (or module) under analysis, and the
+// values that stand for -inf, +inf and 0 at that width. MinWord and MaxWord
+// are Min and Max as machine words, meaningful while MAX_BIT_INT <= 64.
+extern unsigned MAX_BIT_INT;
+extern APInt Min, Max, Zero;
+extern int64_t MinWord, MaxWord;
+
+/// Almost every integer we analyze fits in 64 bits, so ranges built while
+/// MAX_BIT_INT <= 64 keep their bounds as int64_t and do saturating
+/// arithmetic on them, with MinWord and MaxWord as -inf and +inf. Ranges of
+/// wider programs fall back to APInt bounds. getLower and getUpper always
+/// return APInts; the solvers use getLowerWord and getUpperWord when
+/// Range::fitsWord() holds.
 class Range {
 private:
-	APInt l;	// The lower bound of the range.
-	APInt u;	// The upper bound of the range.
+	/// The bounds of a range that does not fit a word, allocated only for
+	/// those, so that the word ranges stay small.
+	struct WideBounds {
+		APInt l;
+		APInt u;
+		WideBounds(const APInt &l, const APInt &u) : l(l), u(u) {}
+	};
+
+	int64_t sl;	// The lower bound of the range, as a machine word.
+	int64_t su;	// The upper bound of the range, as a machine word.
+	WideBounds *wide;	// The bounds of the range, if it does not fit a word.
+	unsigned width;	// MAX_BIT_INT when the range was built.
 	RangeType type;
 
+	bool isWord() const {return width <= 64;}
+
 public:
 	Range();
 	Range(APInt lb, APInt ub, RangeType type = Regular);
+	Range(int64_t lb, int64_t ub, RangeType type = Regular);
+	Range(const Range& other);
+	Range& operator=(const Range& other);
 	~Range();
-	APInt getLower() const {return l;}
-	APInt getUpper() const {return u;}
-	void setLower(const APInt& newl) {this->l = newl;}
-	void setUpper(const APInt& newu) {this->u = newu;}
+	/// True if the ranges built now keep their bounds as machine words.
+	static bool fitsWord() {return MAX_BIT_INT <= 64;}
+	APInt getLower() const {return isWord() ? APInt(width, sl, true) : wide->l;}
+	APInt getUpper() const {return isWord() ? APInt(width, su, true) : wide->u;}
+	int64_t getLowerWord() const {return sl;}
+	int64_t getUpperWord() const {return su;}
+	void setLower(const APInt& newl);
+	void setUpper(const APInt& newu);
 	bool isUnknown() const {return type == Unknown;}
 	void setUnknown() {type = Unknown;}
 	bool isRegular() const {return type == Regular;}
@@ -155,6 +191,8 @@ public:
 	bool isEmpty() const {return type == Empty;}
 	void setEmpty() {type = Empty;}
 	bool isMaxRange() const;
+	/// True if the lower bound is greater than the upper bound.
+	bool isInverted() const;
 	void print(raw_ostream& OS) const;
 	Range add(const Range& other);
 	Range sub(const Range& other);
@@ -207,7 +245,7 @@ public:
 		
 		// Check if lower bound is greater than upper bound. If it is,
 		// set range to empty
-		if (this->interval.getLower().sgt(this->interval.getUpper())) {
+		if (this->interval.isInverted()) {
 			this->interval.setEmpty();
 		}
 	}
@@ -246,7 +284,7 @@ public:
 		
 		// Check if lower bound is greater than upper bound. If it is,
 		// set range to empty
-		if (this->range.getLower().sgt(this->range.getUpper())) {
+		if (this->range.isInverted()) {
 			this->range.setEmpty();
 		}
 	}
@@ -652,8 +690,13 @@ class Profile {
 		// Map to store accumulated times
 		typedef StringMap<TimeValue> AccTimesMap;
 	
+		// Map to store counters and per-SCC maxima
+		typedef StringMap<uint64_t> CountersMap;
+	
 	private:
 		AccTimesMap accumulatedtimes;
+		CountersMap counters;
+		CountersMap maxima;
 		size_t memory;
 	
 	public:
@@ -679,6 +722,21 @@ class Profile {
 			return accumulatedtimes[key];
 		}
 		
+		void addCount(StringRef key, uint64_t n) {
+			counters[key] += n;
+		}
+
+		uint64_t getCount(StringRef key) {
+			return counters[key];
+		}
+
+		void updateMax(StringRef key, uint64_t n) {
+			uint64_t &max = maxima[key];
+			if (n > max) {
+				max = n;
+			}
+		}
+
 		void printTime(StringRef key) {
 			double time = getTimeDouble(key);
 			std::ostringstream formatted;
@@ -704,6 +762,9 @@ class Profile {
 			formatted << (mem / 1024);
 			errs() << formatted.str() << "\t - " << "Memory used in KB\n";
 		}
+
+		/// Prints every time, counter and maximum as a JSON object
+		void printJSON(raw_ostream &OS, StringRef module, StringRef analysis);
 };
 
 // The VarNodes type.
@@ -726,6 +787,33 @@ typedef DenseMap<const Value*, ValueBranchMap> ValuesBranchMap;
 
 typedef DenseMap<const Value*, ValueSwitchMap> ValuesSwitchMap;
 
+// The values a set of range queries depend on (see InterProceduralRA::query)
+typedef SmallPtrSet<const Value*, 64> ValueSlice;
+
+/// The constants that widening jumps to in one SCC, instead of going
+/// straight to -inf or +inf. They are kept as positions in the sorted
+/// thresholds of the graph, so a lookup is a binary search.
+class JumpSet {
+private:
+	const std::vector<APInt> *thresholds;
+	SmallVector<unsigned, 8> indices;
+
+public:
+	JumpSet(const std::vector<APInt> &thresholds) :
+			thresholds(&thresholds) {}
+	void addIndex(unsigned idx) {indices.push_back(idx);}
+	/// Sorts the thresholds and drops the duplicates.
+	void finish();
+	/// The smallest threshold not less than val, or Max.
+	APInt getFirstGreater(const APInt &val) const;
+	/// The largest threshold not greater than val, or Min.
+	APInt getFirstLess(const APInt &val) const;
+};
+
+// The SCCs of a constraint graph in topological order, as solved by
+// ConstraintGraph::solveComponents.
+typedef std::vector<SmallPtrSet<VarNode*, 32>*> ComponentList;
+
 /// This class represents our constraint graph. This graph is used to
 /// perform all computations in our analysis.
 class ConstraintGraph {
@@ -736,6 +824,9 @@ protected:
 	GenOprs oprs;
 
 private:
+	// The memory of the VarNodes and operations, allocated one after the
+	// other and released all at once with the graph.
+	BumpPtrAllocator arena;
     // Save the last Function analyzed
     const Function *func;
 	// A map from variables to the operations that define them
@@ -750,10 +841,6 @@ private:
 	ValuesBranchMap valuesBranchMap;
 	ValuesSwitchMap valuesSwitchMap;
 	
-	// Vector containing the constants from a SCC
-	// It is cleared at the beginning of every SCC resolution
-	SmallVector<APInt, 2> constantvector;
-	
 	/// Adds a BinaryOp in the graph.
 	void addBinaryOp(const Instruction* I);
 	/// Adds a PhiOp in the graph.
@@ -764,27 +851,65 @@ private:
 	void buildOperations(const Instruction* I);
 	void buildValueBranchMap(const BranchInst *br);
 	void buildValueSwitchMap(const SwitchInst *sw);
-	void buildValueMaps(const Function& F);
+	void buildValueMaps(const Function& F, const ValueSlice *slice);
 	
 //	void clearValueMaps();
 
-	void insertConstantIntoVector(APInt constantval);
-	APInt getFirstGreaterFromVector(const SmallVector<APInt, 2> &constantvector, const APInt &val);
-	APInt getFirstLessFromVector(const SmallVector<APInt, 2> &constantvector, const APInt &val);
-	void buildConstantVector(const SmallPtrSet<VarNode*, 32> &component, const UseMap &compusemap);
+	// The jump-set thresholds of the whole graph, sorted and without
+	// duplicates, and the ones that each variable and sigma brings to its SCC
+	std::vector<APInt> thresholds;
+	DenseMap<const Value*, SmallVector<unsigned, 2> > varThresholds;
+	DenseMap<const BasicOp*, SmallVector<unsigned, 2> > sigmaThresholds;
+
+	/// Builds the threshold index once for all the SCCs.
+	void buildThresholds();
+	/// Indexes the thresholds of values and of the sigmas that define them.
+	/// The index is built again only if they bring constants it lacks.
+	void updateThresholds(const SmallPtrSet<const Value*, 64> &values);
+	/// The thresholds of component, looked up in the index.
+	void buildJumpSet(const SmallPtrSet<VarNode*, 32> &component,
+			const UseMap &compusemap, JumpSet &jumpset);
+
+	// The values whose operations were added or removed since the last solve
+	SmallPtrSet<const Value*, 16> changedValues;
+	// The variables added since the graph was last initialized or solved
+	SmallVector<const Value*, 16> newVars;
+	// The values given to removeValue since the last dropRemovedValues
+	SmallPtrSet<const Value*, 16> removedValues;
+	// Nodes and operations taken out of the graph. Their memory is in the
+	// arena, so they are only destroyed with the graph and these lists grow
+	// with every removal until then
+	SmallVector<VarNode*, 4> removedVars;
+	SmallVector<BasicOp*, 4> removedOprs;
+	/// Keeps symbMap up to date with an operation added to, or taken out
+	/// of, the graph after buildSymbolicIntersectMap.
+	void addSymbolicIntersect(BasicOp *op);
+	void removeSymbolicIntersect(BasicOp *op);
+
+	/// Solves one SCC. The components before it must be solved already.
+	void solveComponent(SmallPtrSet<VarNode*, 32> &component);
+	/// Solves the SCCs in topological order, several at a time if
+	/// nThreads > 1.
+	void solveComponents(const ComponentList &components, unsigned nThreads);
+	static void* solveWorker(void *schedule);
+	/// Evaluates the operations in order, as propagateToNextSCC does.
+	void evalOperations(const std::vector<BasicOp*> &ops);
 	// Perform the widening and narrowing operations
 
 protected:
 	void update(const UseMap &compUseMap,
-		SmallPtrSet<const Value*, 6>& actv, bool (*meet)(BasicOp* op, const SmallVector<APInt, 2> *constantvector));
+		SmallPtrSet<const Value*, 6>& actv, bool (*meet)(BasicOp* op, const JumpSet *jumpset),
+		const JumpSet &jumpset);
 	void update(unsigned nIterations, const UseMap &compUseMap,
 			SmallPtrSet<const Value*, 6>& actv);
 
 	virtual void preUpdate(const UseMap &compUseMap,
-		SmallPtrSet<const Value*, 6>& entryPoints) = 0;
+		SmallPtrSet<const Value*, 6>& entryPoints,
+		const JumpSet &jumpset) = 0;
 	virtual void posUpdate(const UseMap &compUseMap,
 		SmallPtrSet<const Value*, 6>& activeVars,
-		const SmallPtrSet<VarNode*, 32> *component) = 0;
+		const SmallPtrSet<VarNode*, 32> *component,
+		const JumpSet &jumpset) = 0;
 
 public:
 	/// I'm doing this because I want to use this analysis in an
@@ -794,6 +919,9 @@ public:
 	virtual ~ConstraintGraph();
 	/// Adds a VarNode in the graph.
 	VarNode* addVarNode(const Value* V);
+	/// Memory for a node or operation of the graph, to be built with
+	/// placement new. The graph destroys it together with the others.
+	template<class T> void* allocate() { return arena.Allocate<T>(); }
 	
 	GenOprs* getOprs() {return &oprs;}
 	DefMap* getDefMap() {return &defMap;}
@@ -802,7 +930,8 @@ public:
 	/// Adds an UnaryOp to the graph.
 	void addUnaryOp(const Instruction* I);
 	/// Iterates through all instructions in the function and builds the graph.
-	void buildGraph(const Function& F);
+	/// If slice is given, only its instructions get operations.
+	void buildGraph(const Function& F, const ValueSlice *slice = NULL);
 	void buildVarNodes();
 	void buildSymbolicIntersectMap();
 	UseMap buildUseMap(const SmallPtrSet<VarNode*, 32> &component);
@@ -810,6 +939,29 @@ public:
 
 	/// Finds the intervals of the variables in the graph.
 	void findIntervals();
+	/// The meet operators used by findIntervals, e.g. for cache keys.
+	virtual const char *getSolverName() const = 0;
+
+	/// Adds the operation of an instruction that a later pass inserted
+	/// after the graph was solved, like a sigma, a check or a redefinition.
+	void addValue(const Instruction *I);
+	/// Takes the operation that defines V out of the graph. V itself stays
+	/// in it until dropRemovedValues. The memory of the operation is only
+	/// released with the graph, so a graph that is updated for a long time
+	/// keeps growing with the removed operations.
+	void removeValue(const Value *V);
+	/// Called after all the removals: takes out the removed values that no
+	/// operation uses anymore, and keeps the others as inputs. As with the
+	/// operations, their nodes are only released with the graph.
+	void dropRemovedValues();
+	/// Makes resolve solve V again, for operations on V that were not built
+	/// by addValue, like the matching of parameters and return values.
+	void markChanged(const Value *V) { changedValues.insert(V); }
+	/// Solves again, after addValue and removeValue, the SCCs that the
+	/// changes can reach. The ranges of the other SCCs are kept, and only
+	/// the variables these SCCs hold are looked at. The pseudo-edges that
+	/// Nuutila adds are allocated outside the graph and freed when it ends.
+	void resolve();
 	void generateEntryPoints(SmallPtrSet<VarNode*, 32> &component, SmallPtrSet<const Value*, 6> &entryPoints);
 	void fixIntersects(SmallPtrSet<VarNode*, 32> &component);
 	void generateActivesVars(SmallPtrSet<VarNode*, 32> &component, SmallPtrSet<const Value*, 6> &activeVars);
@@ -829,26 +981,32 @@ public:
 
 class Cousot: public ConstraintGraph {
 private:
-	void preUpdate(const UseMap &compUseMap, SmallPtrSet<const Value*, 6>& entryPoints);
+	void preUpdate(const UseMap &compUseMap, SmallPtrSet<const Value*, 6>& entryPoints,
+		const JumpSet &jumpset);
 	void posUpdate(const UseMap &compUseMap,
 		SmallPtrSet<const Value*, 6>& activeVars,
-		const SmallPtrSet<VarNode*, 32> *component);
+		const SmallPtrSet<VarNode*, 32> *component,
+		const JumpSet &jumpset);
 
 public:
 	Cousot(): ConstraintGraph() {}
+	const char *getSolverName() const {return "cousot";}
 };
 
 class CropDFS: public ConstraintGraph{
 private:
-	void preUpdate(const UseMap &compUseMap, SmallPtrSet<const Value*, 6>& entryPoints);
+	void preUpdate(const UseMap &compUseMap, SmallPtrSet<const Value*, 6>& entryPoints,
+		const JumpSet &jumpset);
 	void posUpdate(const UseMap &compUseMap,
 		SmallPtrSet<const Value*, 6>& activeVars,
-		const SmallPtrSet<VarNode*, 32> *component);
+		const SmallPtrSet<VarNode*, 32> *component,
+		const JumpSet &jumpset);
 	void storeAbstractStates(const SmallPtrSet<VarNode*, 32> *component);
 	void crop(const UseMap &compUseMap, BasicOp *op);
 
 public:
 	CropDFS(): ConstraintGraph() {}
+	const char *getSolverName() const {return "cropdfs";}
 };
 
 class Nuutila {
@@ -867,10 +1025,12 @@ public:
     bool hasEdge(SmallPtrSet<VarNode*, 32> *componentFrom, SmallPtrSet<VarNode*, 32> *componentTo, UseMap *useMap);
 #endif
 public:
-	Nuutila(VarNodes *varNodes, UseMap *useMap, SymbMap *symbMap, bool single = false);
+	Nuutila(VarNodes *varNodes, UseMap *useMap, SymbMap *symbMap,
+			bool single = false);
 	~Nuutila();
 
-	void addControlDependenceEdges(SymbMap *symbMap, UseMap *useMap, VarNodes* vars);
+	void addControlDependenceEdges(SymbMap *symbMap, UseMap *useMap,
+			VarNodes* vars);
 	void delControlDependenceEdges(UseMap *useMap);
 	void visit(Value *V, std::stack<Value*> &stack, UseMap *useMap);
 	typedef std::deque<Value*>::reverse_iterator iterator;
@@ -881,16 +1041,18 @@ public:
 class Meet{
 
 public:
-	static bool widen(BasicOp* op, const SmallVector<APInt, 2> *constantvector);
-	static bool narrow(BasicOp* op, const SmallVector<APInt, 2> *constantvector);
-	static bool crop(BasicOp* op, const SmallVector<APInt, 2> *constantvector);
-	static bool growth(BasicOp* op, const SmallVector<APInt, 2> *constantvector);
-	static bool fixed(BasicOp* op, const SmallVector<APInt, 2> *constantvector);
+	static bool widen(BasicOp* op, const JumpSet *jumpset);
+	static bool narrow(BasicOp* op, const JumpSet *jumpset);
+	static bool crop(BasicOp* op, const JumpSet *jumpset);
+	static bool growth(BasicOp* op, const JumpSet *jumpset);
+	static bool fixed(BasicOp* op, const JumpSet *jumpset);
 };
 
 class RangeAnalysis{
 protected:
 	ConstraintGraph *CG;
+	/// The times and counters of this analysis, written with -raProfile
+	Profile profile;
 public:
 	/** Gets the maximum bit width of the operands in the instructions of the
 	 * function. This function is necessary because the class APInt only
@@ -912,16 +1074,34 @@ template <class CGT>
 class InterProceduralRA: public ModulePass, RangeAnalysis{
 public:
 	static char ID; // Pass identification, replacement for typeid
-	InterProceduralRA() : ModulePass(ID) { CG = NULL; }
+	InterProceduralRA() : ModulePass(ID) { CG = NULL; width = 1; }
 	~InterProceduralRA();
 	bool runOnModule(Module &M);
+	bool doFinalization(Module &M);
 	static unsigned getMaxBitWidth(Module &M);
 
 	virtual APInt getMin();
 	virtual APInt getMax();
 	virtual Range getRange(const Value *v);
+	/// With -raDemand, builds and solves only the part of the constraint
+	/// graph that the ranges of values (and of earlier queries) depend on.
+	/// Later queries extend the graph with the values the earlier ones did
+	/// not reach and solve again only the SCCs these values change, so
+	/// getRange can query the values it has not seen one at a time.
+	void query(const SmallVectorImpl<const Value*> &values);
+	/// For passes that change the IR after the ranges were found: takes the
+	/// removed values out of the constraint graph, adds the new
+	/// instructions, and solves again only the SCCs these changes reach.
+	/// Call it before the removed instructions are erased.
+	void update(const SmallVectorImpl<const Instruction*> &added,
+			const SmallVectorImpl<const Value*> &removed);
 private:
 	void MatchParametersAndReturnValues(Function &F, ConstraintGraph &G);
+
+	// State of the demand-driven mode
+	unsigned width;
+	ValueSlice slice;
+	SmallPtrSet<Function*, 16> sliceFunctions;
 };
 
 template <class CGT>
@@ -932,6 +1112,8 @@ public:
 	~IntraProceduralRA();
 	void getAnalysisUsage(AnalysisUsage &AU) const { };
 	bool runOnFunction(Function &F);
+	/// Writes the range cache to -raCacheFile.
+	bool doFinalization(Module &M);
 
 	virtual APInt getMin();
 	virtual APInt getMax();
@@ -0,0 +1,101 @@
+#define DEBUG_TYPE "controldependence"
+
+#include "ControlDependence.h"
+
+static const std::vector<BasicBlock*> noDependents;
+
+void ControlDependence::getAnalysisUsage(AnalysisUsage &AU) const {
+	AU.addRequired<PostDominatorTree> ();
+	AU.setPreservesAll();
+}
+
+void ControlDependence::releaseMemory() {
+	dependents.clear();
+}
+
+bool ControlDependence::runOnFunction(Function &F) {
+	PostDominatorTree &PD = getAnalysis<PostDominatorTree> ();
+
+	dependents.clear();
+	for (Function::iterator A = F.begin(), eF = F.end(); A != eF; ++A) {
+		TerminatorInst *ti = A->getTerminator();
+		if (ti == NULL)
+			continue;
+
+		SmallPtrSet<BasicBlock*, 32> added;
+		for (unsigned int i = 0; i < ti->getNumSuccessors(); i++)
+			addDependents(A, ti->getSuccessor(i), PD, added);
+	}
+
+	return false;
+}
+
+//Walks the post-dominator tree from S up to the immediate post-dominator of A
+void ControlDependence::addDependents(BasicBlock* A, BasicBlock* S,
+		PostDominatorTree &PD, SmallPtrSet<BasicBlock*, 32> &added) {
+	DomTreeNode *runner = PD.getNode(S);
+
+	//S never reaches an exit (infinite loop): nothing post-dominates it
+	if (runner == NULL) {
+		if (added.insert(S))
+			dependents[A].push_back(S);
+		return;
+	}
+
+	DomTreeNode *stop = PD.getNode(A) ? PD.getNode(A)->getIDom() : NULL;
+	while (runner != NULL && runner != stop && runner->getBlock() != NULL) {
+		if (added.insert(runner->getBlock()))
+			dependents[A].push_back(runner->getBlock());
+		runner = runner->getIDom();
+	}
+}
+
+const std::vector<BasicBlock*>& ControlDependence::getDependents(
+		BasicBlock* BB) const {
+	DenseMap<BasicBlock*, std::vector<BasicBlock*> >::const_iterator it =
+			dependents.find(BB);
+	if (it == dependents.end())
+		return noDependents;
+	return it->second;
+}
+
+void ControlDependence::getInfluenceRegion(BasicBlock* BB,
+		std::vector<BasicBlock*> &region, std::vector<BasicBlock*> &exits,
+		const SmallPtrSet<BasicBlock*, 32>* noExpand) const {
+	SmallPtrSet<BasicBlock*, 32> inRegion;
+	std::vector<BasicBlock*> stack, expanded;
+
+	//Transitive closure of the dependents of BB
+	stack.push_back(BB);
+	while (!stack.empty()) {
+		BasicBlock *A = stack.back();
+		stack.pop_back();
+		expanded.push_back(A);
+
+		const std::vector<BasicBlock*> &deps = getDependents(A);
+		for (std::vector<BasicBlock*>::const_reverse_iterator it = deps.rbegin(),
+				e = deps.rend(); it != e; ++it) {
+			if (!inRegion.insert(*it))
+				continue;
+			region.push_back(*it);
+			if (noExpand == NULL || !noExpand->count(*it))
+				stack.push_back(*it);
+		}
+	}
+
+	//Successors left out of the region post-dominate BB
+	SmallPtrSet<BasicBlock*, 32> isExit;
+	for (std::vector<BasicBlock*>::iterator it = expanded.begin(), e =
+			expanded.end(); it != e; ++it) {
+		TerminatorInst *ti = (*it)->getTerminator();
+		for (unsigned int i = 0; ti && i < ti->getNumSuccessors(); i++) {
+			BasicBlock *S = ti->getSuccessor(i);
+			if (S != BB && !inRegion.count(S) && isExit.insert(S))
+				exits.push_back(S);
+		}
+	}
+}
+
+char ControlDependence::ID = 0;
+static RegisterPass<ControlDependence> X("controlDependence",
+		"Control dependence graph from the post-dominator tree", true, true);
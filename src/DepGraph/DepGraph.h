@@ -11,6 +11,8 @@
 #include "llvm/Module.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/DominanceFrontier.h"
 #include "llvm/ADT/DenseMap.h"
@@ -18,6 +20,9 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 #include "../AliasSets/AliasSets.h"
@@ -30,6 +35,8 @@
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 
 using namespace std;
@@ -41,9 +48,22 @@ STATISTIC(NrMemNodes, "Number of memory nodes");
 STATISTIC(NrEdges, "Number of edges");
 
 typedef enum {
-	etData = 0, etControl = 1
+	etData = 0, etControl = 1, etSummary = 2
 } edgeType;
 
+//Number of worker threads of the dependence graph passes (-depGraphThreads)
+extern cl::opt<unsigned> depGraphThreads;
+
+/*
+ * Function parallelFor
+ *
+ * Calls body(i, context) for every i in [0, n) using nThreads threads. The
+ * calling thread takes part in the work, so nThreads <= 1 runs the loop
+ * serially. The order of the calls is not specified.
+ */
+void parallelFor(unsigned n, unsigned nThreads, void (*body)(unsigned, void*),
+		void* context);
+
 /*
  * Class GraphNode
  *
@@ -65,9 +85,11 @@ private:
 	std::map<GraphNode*, edgeType> successors;
 	std::map<GraphNode*, edgeType> predecessors;
 
-	static int currentID;
+	static sys::cas_flag currentID;
 	int ID;
 
+	friend class Graph;
+
 protected:
 	int Class_ID;
 public:
@@ -86,9 +108,17 @@ public:
 	std::map<GraphNode*, edgeType> getPredecessors();
 	bool hasPredecessor(GraphNode* pred);
 
+	//Walk the edges without copying them
+	typedef std::map<GraphNode*, edgeType>::iterator edge_iterator;
+	edge_iterator succ_begin();
+	edge_iterator succ_end();
+	edge_iterator pred_begin();
+	edge_iterator pred_end();
+
 	void connect(GraphNode* dst, edgeType type = etData);
 	int getClass_Id() const;
 	int getId() const;
+	static unsigned getNumIds(); //Every ID given so far is lower than this
 	std::string getName();
 	virtual std::string getLabel() = 0;
 	virtual std::string getShape() = 0;
@@ -258,11 +288,22 @@ private:
 
 	std::set<GraphNode*> nodes;
 
+	std::set<Value*> droppedCallNodes; //Calls whose CallNode was deleted after matching parameters
+	llvm::DenseMap<Function*, std::set<Value*> > functionValues; //Arguments and instructions given nodes, by function. Kept as keys only: they may be erased from the IR before removeFunction
+	llvm::DenseMap<Function*, GraphNode*> joinNodes; //Entry gate of each gated function
+
+	typedef std::pair<GraphNode*, GraphNode*> SummaryEdge;
+	std::map<SummaryEdge, std::vector<GraphNode*> > summaryPaths; //Path through the callee behind each summary edge, from src to dst
+
 	AliasSets *AS;
 
 	bool isValidInst(Value *v); //Return true if the instruction is valid for dependence graph construction
 	bool isMemoryPointer(Value *v); //Return true if the value is a memory pointer
 
+	void mergeSubGraph(Graph *sub); //Move the nodes of sub into this graph, unifying shared VarNodes and MemNodes
+	void addFunctionValue(Value *v); //Record v in functionValues, if it is an argument or an instruction
+	void expandPath(const std::vector<GraphNode*> &path,
+			std::set<SummaryEdge> &expanding, std::vector<GraphNode*> &expanded); //Append path[1..] to expanded, expanding its summary edges
 
 public:
 
@@ -279,13 +320,44 @@ public:
 	~Graph(); //Destructor - Free adjacent matrix's memory
 
 	std::set<GraphNode*> getDepValues(
-			std::set<llvm::Value*> sources, bool forward=true);
+			std::set<llvm::Value*> sources, bool forward=true, bool useSummaries=false);
+
+	/*
+	 * Function getDepValues
+	 *
+	 * Same search, with the result as a bit vector indexed by node ID. The
+	 * visited set costs one bit per node instead of a tree insertion.
+	 */
+	void getDepValues(std::set<llvm::Value*> sources, BitVector &result,
+			bool forward=true, bool useSummaries=false);
 	int getTaintedEdges();
 	int getTaintedNodesSize();
 
 	GraphNode* addInst(Value *v); //Add an instruction into Dependence Graph
 
+	void addFunction(Function *F); //Add every instruction of F into Dependence Graph
+
+	/*
+	 * Function addFunctions
+	 *
+	 * Builds one subgraph per function using nThreads threads and merges the
+	 * subgraphs in the order of the vector. Node IDs are the same ones a serial
+	 * sequence of addFunction calls would produce.
+	 */
+	void addFunctions(std::vector<Function*> &functions, unsigned nThreads);
+
 	void addEdge(GraphNode* src, GraphNode* dst, edgeType type = etData);
+	void removeEdge(GraphNode* src, GraphNode* dst);
+
+	/*
+	 * Function addJoin
+	 *
+	 * Returns the entry gate of F, creating it on first use: one node with
+	 * control edges to every node of F. A predicate that gates a call to F
+	 * needs a single edge to that node, however large F is.
+	 */
+	GraphNode* addJoin(Function *F);
+	GraphNode* findJoinNode(Function *F); //Return the entry gate of F or NULL if it has none
 
 	GraphNode* findNode(Value *op); //Return the pointer to the node or NULL if it is not in the graph
 	std::set<GraphNode*> findNodes(std::set<Value*> values);
@@ -313,6 +385,52 @@ public:
 	void toDot(std::string s, raw_ostream *stream); //print in any stream
 	void toDot(std::string s, raw_ostream *stream, llvm::Graph::Guider* g);
 
+	/*
+	 * Class ExportFilter
+	 *
+	 * Selects the part of the graph written by exportGraph:
+	 *              - Nodes: the given nodes and every node up to k hops away from them,
+	 *                in both directions. If no node is given, the whole graph.
+	 *              - Edges: the edge types to write and to follow. By default, all of them.
+	 */
+	class ExportFilter {
+	public:
+		ExportFilter();
+		void addNode(GraphNode* n);
+		void setHops(unsigned hops);
+		void addEdgeType(edgeType type); //Once a type is added, only the added types are accepted
+		bool acceptsEdge(edgeType type) const;
+		std::set<GraphNode*> &getNodes();
+		unsigned getHops() const;
+	private:
+		std::set<GraphNode*> nodes;
+		unsigned hops;
+		unsigned edgeTypes; //One bit per edgeType
+	};
+
+	typedef enum {
+		efDot = 0, efJSON = 1
+	} exportFormat;
+
+	/*
+	 * Function exportGraph
+	 *
+	 * Streams the nodes and edges selected by the filter in one pass. efJSON writes
+	 * one JSON object per line: {"node":id,...} for nodes and {"src":id,"dst":id,...}
+	 * for edges. Only the selected nodes are kept in memory.
+	 */
+	void exportGraph(std::string s, raw_ostream *stream, ExportFilter &filter,
+			exportFormat format = efDot);
+	void exportGraph(std::string s, std::string fileName, ExportFilter &filter,
+			exportFormat format = efDot);
+
+	//binary format (see class MappedGraph)
+	typedef DenseMap<GraphNode*, std::pair<Value*, unsigned> > PHIOwnerMap; //PHI nodes without a value: (function, argument number) for formal parameters, (call site, 0) for return values
+	bool writeBinary(Module &M, std::string fileName,
+			const PHIOwnerMap *owners = NULL); //Return false if the file can't be written
+	bool readBinary(Module &M, std::string fileName, PHIOwnerMap *owners =
+			NULL); //Load into an empty graph. Return false if the file is invalid or was written for another module
+
 	Graph generateSubGraph(Value *src, Value *dst); //Take a source value and a destination value and find a Connecting Subgraph from source to destination
 
 	void dfsVisit(GraphNode* u, GraphNode* u2,
@@ -321,6 +439,20 @@ public:
 			std::set<GraphNode*> &visitedNodes); //Used by findConnectingSubgraph() method
 
 	void deleteCallNodes(Function* F);
+	void deleteCallNode(Instruction* caller);
+
+	void removeNode(GraphNode* node); //Disconnect the node and free it
+
+	/*
+	 * Function removeFunction
+	 *
+	 * Deletes the nodes of the arguments and instructions of F, as they were
+	 * when the nodes were built: instructions erased since then are not looked
+	 * at, only their map entries. MemNodes and the nodes of constants and
+	 * globals that were only used by F are deleted too. The function can be
+	 * inserted again with addFunction.
+	 */
+	void removeFunction(Function* F);
 
 	/*
 	 * Function getNearestDependence
@@ -328,7 +460,7 @@ public:
 	 * Given a sink, returns the nearest source in the graph and the distance to the nearest source
 	 */
 	std::pair<GraphNode*, int> getNearestDependency(Value* sink,
-			std::set<Value*> sources, bool skipMemoryNodes);
+			std::set<Value*> sources, bool skipMemoryNodes, bool useSummaries = false);
 
 	/*
 	 * Function getEveryDependency
@@ -337,7 +469,24 @@ public:
 	 */
 	std::map<GraphNode*, std::vector<GraphNode*> > getEveryDependency(
 			llvm::Value* sink, std::set<llvm::Value*> sources,
-			bool skipMemoryNodes);
+			bool skipMemoryNodes, bool useSummaries = false);
+
+	/*
+	 * Function getPredecessors
+	 *
+	 * Returns the predecessors of n. If useSummaries is true and n is the result
+	 * of a call with summary edges, the PHI of the return values of the callee is
+	 * left out, so backward traversals jump over the callee body. Summary edges
+	 * only cover inputs (memory, arguments, results of external calls, and the
+	 * nodes of other functions or without predecessors), so they are exact for
+	 * taint sources but not for arbitrary values.
+	 */
+	std::map<GraphNode*, edgeType> getPredecessors(GraphNode* n, bool useSummaries);
+
+	std::vector<GraphNode*> findPath(GraphNode* src, GraphNode* dst); //Shortest path from src to dst without summary edges
+	void setSummaryPath(GraphNode* src, GraphNode* dst,
+			std::vector<GraphNode*> &path); //Record the path behind the summary edge, unless it has one. Dropped with the edge
+	void expandSummaryEdges(std::vector<GraphNode*> &path); //Replace each summary edge of the path by its recorded path, recursively
 
 	int getNumOpNodes();
 	int getNumCallNodes();
@@ -345,10 +494,79 @@ public:
 	int getNumVarNodes();
 	int getNumDataEdges();
 	int getNumControlEdges();
+	int getNumSummaryEdges();
 	int getNumEdges(edgeType type);
 
 };
 
+/*
+ * Class MappedGraph
+ *
+ * Read-only view of a dependence graph stored in the binary format written
+ * by Graph::writeBinary. The file is memory-mapped and used in place:
+ *              - Header: magic, version and sizes
+ *              - Node table: kind, opcode or alias set ID, and a handle to the Value
+ *              - Edges in CSR form: per-node offsets, then targets, then edge types
+ *
+ * Values are identified by their position in the module (globals and functions,
+ * then the arguments and instructions of each function). Values without a
+ * position, such as constants, are identified by the first operand that uses
+ * them. Nodes are stored in ID order and all fields are in native byte order.
+ */
+class MappedGraph {
+public:
+	static const uint32_t Version = 2;
+
+	//vkFormal and vkReturn are the PHI nodes of moduleDepGraph (see Graph::PHIOwnerMap)
+	typedef enum {
+		vkNone = 0, vkValue = 1, vkOperand = 2, vkFormal = 3, vkReturn = 4
+	} valueKind;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t numValues;
+		uint32_t moduleHash; //Shape of the module the graph was built for
+		uint32_t numNodes;
+		uint32_t numEdges;
+	};
+
+	struct Node {
+		uint32_t kind; //Class_ID of the GraphNode
+		uint32_t data; //OpCode of OpNodes, alias set ID of MemNodes
+		uint32_t valueKind;
+		uint32_t valueIndex; //Position of the Value, of the User for vkOperand, or of the owner of the PHI
+		uint32_t operand; //Operand number, or argument number for vkFormal
+	};
+
+	MappedGraph() :
+		header(NULL), nodeTable(NULL), offsets(NULL), targets(NULL), types(NULL) {
+	}
+	;
+
+	bool open(std::string fileName); //Map the file and check its consistency
+
+	unsigned getNumValues() const;
+	unsigned getModuleHash() const;
+	unsigned getNumNodes() const;
+	unsigned getNumEdges() const;
+	const Node& getNode(unsigned i) const;
+	const uint32_t* succBegin(unsigned i) const;
+	const uint32_t* succEnd(unsigned i) const;
+	edgeType getEdgeType(const uint32_t* succ) const;
+
+	static void numberValues(Module &M, std::vector<Value*> &values); //Values in the order used by vkValue handles
+	static uint32_t hashValues(std::vector<Value*> &values);
+
+private:
+	OwningPtr<MemoryBuffer> buffer;
+	const Header* header;
+	const Node* nodeTable;
+	const uint32_t* offsets;
+	const uint32_t* targets;
+	const uint8_t* types;
+};
+
 /*
  * Class functionDepGraph
  *
@@ -385,7 +603,56 @@ public:
 	void matchParametersAndReturnValues(Function &F);
 	void deleteCallNodes(Function* F);
 
+	/*
+	 * Function updateFunction
+	 *
+	 * Brings the graph up to date after F has been modified, touching only the
+	 * nodes of F: its instructions are inserted again, its formal parameters and
+	 * return values are matched again to its call sites, and the calls made by F
+	 * are matched again to their callees. Edges added by other passes (e.g.
+	 * control edges) for F are not restored. Transformation passes that keep
+	 * moduleDepGraph alive must call it for every function they change.
+	 */
+	void updateFunction(Function &F);
+
+	/*
+	 * Function summarizeFunction
+	 *
+	 * Finds the inputs the return values of F depend on: formal parameters,
+	 * memory, results of external calls, nodes of other functions and nodes
+	 * without predecessors (e.g. globals). Each call site of F gets a summary
+	 * edge from each of these inputs (from the actual parameter for formal ones)
+	 * to the result of the call, and the path that justifies it. Calls made by F
+	 * are crossed through their summary edges only, so callees should be
+	 * summarized first. Returns true if an edge was added.
+	 */
+	bool summarizeFunction(Function &F);
+	void clearSummary(Function &F); //Remove the summary edges of the call sites of F
+	void computeSummaries(Module &M); //Summarize every function, callees first
+
+	/*
+	 * Function print
+	 *
+	 * For -analyze: one "caller: call <- input" line per summary edge. Memory
+	 * inputs are written as memory(aliases), with the names of their aliases.
+	 */
+	void print(raw_ostream &O, const Module *M) const;
+
 	Graph* depGraph;
+
+private:
+	void matchCallSite(Function &F, Instruction *caller,
+			SmallPtrSet<Value*, 8> &ReturnValues);
+	void getReturnValues(Function &F, SmallPtrSet<Value*, 8> &ReturnValues);
+	void sortCallees(Function &F, std::set<Function*> &visited,
+			std::vector<Function*> &order); //Append F to order after its callees
+	void summarizeToFixpoint(std::vector<Function*> &order);
+	void getPHIOwners(Graph::PHIOwnerMap &owners);
+	void setPHIOwners(Module &M, Graph::PHIOwnerMap &owners);
+
+	DenseMap<Function*, std::vector<GraphNode*> > formalPHIs; //PHI nodes of the formal parameters
+	DenseMap<Instruction*, GraphNode*> returnPHIs; //PHI node of the return value at each call site
+	DenseMap<Function*, std::set<Instruction*> > returnPHICalls; //The call sites in returnPHIs, by the function they are in
 };
 
 class ViewModuleDepGraph: public ModulePass {
@@ -400,23 +667,7 @@ public:
 		AU.setPreservesAll();
 	}
 
-	bool runOnModule(Module& M) {
-
-		moduleDepGraph& DepGraph = getAnalysis<moduleDepGraph> ();
-		Graph *g = DepGraph.depGraph;
-
-		std::string tmp = M.getModuleIdentifier();
-		replace(tmp.begin(), tmp.end(), '\\', '_');
-
-		std::string Filename = "/tmp/" + tmp + ".dot";
-
-		//Print dependency graph (in dot format)
-		g->toDot(M.getModuleIdentifier(), Filename);
-
-		//                DisplayGraph(Filename, true, GraphProgram::DOT);
-
-		return false;
-	}
+	bool runOnModule(Module& M);
 };
 }
 
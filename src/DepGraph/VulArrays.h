@@ -29,13 +29,19 @@
 
 using namespace llvm;
 
+//Candidates found in one function by the parallel scan of VulArrays
+struct ArrayScan {
+	std::set<Value*> arrays; //array allocas
+	std::vector<std::pair<GetElementPtrInst*, AllocaInst*> > structGEPs; //array field GEP and the struct it indexes
+	std::vector<Value*> structCasts; //casted structs that contain arrays
+	unsigned numBlocks, numInsts, numStores;
+};
 
 class VulArrays : public ModulePass {
 	private:
 		bool runOnModule(Module &M);
 		void searchForArray(Value* V);
 		void findVulLocals(const Value* V);
-		bool structHasArray(StructType* ST);
 		//vulnerable node n: (input value v: path from v to n)
 		DenseMap<GraphNode*, DenseMap<const Value*, std::vector<GraphNode*> > > Arrays;
 		DenseMap<GraphNode*, DenseMap<const Value*, std::vector<GraphNode*> > > Structs1;
@@ -45,12 +51,23 @@ class VulArrays : public ModulePass {
 
 		const Value* isValueInpDep(Value* V, std::set<Value*> inputDepValues);
 		DenseMap<const Value*, std::vector<GraphNode*> > getValueDeps(Value* V, std::set<Value*> inputDepValues);
+
+		//single sweep: the inputs that reach each node, one bit per input
+		std::vector<GraphNode*> sweepSources;
+		DenseMap<GraphNode*, BitVector> sweepReach;
+		std::vector<DenseMap<GraphNode*, GraphNode*> > sweepParents; //per input: the node each node was first reached from
+		SmallPtrSet<GraphNode*, 32> sweepSummarized; //call results with summary edges
+		bool sweepFollows(GraphNode* n, GraphNode* succ);
+		void sweepInputs(std::set<Value*> &inputDepValues);
+		DenseMap<const Value*, std::vector<GraphNode*> > getSweptDeps(Value* V, std::set<Value*> &inputDepValues);
+		DenseMap<const Value*, std::vector<GraphNode*> > findDeps(Value* V, std::set<Value*> &inputDepValues);
 		void toDot(std::string name);
 //		void printStats();
 	public:
 		static char ID;
 		void getAnalysisUsage(AnalysisUsage &AU) const;
 		VulArrays();
+		static bool structHasArray(StructType* ST);
 		void printArrays();
 		void printStats();
 		DenseMap<GraphNode*, DenseMap<const Value*, std::vector<GraphNode*> > > getVulArrays();
@@ -1,15 +1,8 @@
 #define DEBUG_TYPE "addStore"
 #include "AddStore.h"
 
-/** Functions analyzed:
- * memcpy OK
- * memmove OK
- * memset OK
- * strcat OK
- * strncat OK
- * strcpy OK
- * strncpy OK
- * sprintf
+/** Functions analyzed: the copy entries of the SourceSinks catalog
+ * (memcpy, memmove, memset, strcat, strncat, strcpy, strncpy, sprintf)
  */
 
 AddStore::AddStore() :
@@ -19,43 +12,30 @@ AddStore::AddStore() :
 bool AddStore::runOnModule(Module &M) {
 	moduleDepGraph &mdg = getAnalysis<moduleDepGraph> ();
 	depGraph = mdg.depGraph;
+	SourceSinks &catalog = SourceSinks::get();
+	catalog.cacheFunctions(M);
 	for (Module::iterator F = M.begin(), eM = M.end(); F != eM; ++F) {
 		for (Function::iterator BB = F->begin(), e = F->end(); BB != e; ++BB) {
 			for (BasicBlock::iterator I = BB->begin(), ee = BB->end(); I != ee; ++I) {
-				if (CallInst *CI = dyn_cast<CallInst>(I)) {
-					Function *Callee = CI->getCalledFunction();
-					if (Callee) {
-						StringRef Name = Callee->getName();
-						if (Name.equals("memcpy") || Name.equals("strcpy")
-								|| Name.equals("memmove") || Name.equals(
-								"memset") || Name.equals("strcat")
-								|| Name.equals("strncat") || Name.equals(
-								"strncpy")) { //src: arg1, dest: arg0
-							Value* src = CI->getArgOperand(1);
-							Value* dest = CI->getArgOperand(0);
-							if (dest->getType()->isPointerTy()) {
-								GraphNode* srcN = depGraph->findNode(src);
-								OpNode* store = new OpNode(Instruction::Store);
-								GraphNode* destN = depGraph->findNode(dest);
-								depGraph->addEdge(srcN, store);
-								depGraph->addEdge(store, destN);
-							}
-						} else if (Name.equals("sprintf")) {
-							Value* dest = CI->getArgOperand(0);
-							if (dest->getType()->isPointerTy()) {
-								Value* src;
-								GraphNode* destN = depGraph->findNode(dest);
-								for (unsigned i = 2, eee =
-										CI->getNumArgOperands(); i != eee; ++i) { //skip format specifier
-									src = CI->getArgOperand(i);
-									GraphNode* srcN = depGraph->findNode(src);
-									OpNode* store = new OpNode(Instruction::Store);
-									depGraph->addEdge(srcN, store);
-									depGraph->addEdge(store, destN);
-								}
-							}
-						}
-					}
+				CallInst *CI = dyn_cast<CallInst>(I);
+				if (!CI)
+					continue;
+				const CallRole* role = catalog.lookup(CI);
+				if (!role || role->role != crCopy
+						|| role->dst >= CI->getNumArgOperands())
+					continue;
+				Value* dest = CI->getArgOperand(role->dst);
+				if (!dest->getType()->isPointerTy())
+					continue;
+				GraphNode* destN = depGraph->findNode(dest);
+				std::vector<Value*> srcs;
+				role->getValues(CI, srcs);
+				for (std::vector<Value*>::iterator src = srcs.begin(), se =
+						srcs.end(); src != se; ++src) {
+					GraphNode* srcN = depGraph->findNode(*src);
+					OpNode* store = new OpNode(Instruction::Store);
+					depGraph->addEdge(srcN, store);
+					depGraph->addEdge(store, destN);
 				}
 			}
 		}
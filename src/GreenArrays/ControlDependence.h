@@ -0,0 +1,59 @@
+#ifndef __CONTROL_DEPENDENCE_H__
+#define __CONTROL_DEPENDENCE_H__
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include <vector>
+
+using namespace llvm;
+
+/*
+ * Class ControlDependence
+ *
+ * The control dependence graph of a function, built once from its post-dominator
+ * tree (Ferrante, Ottenstein and Warren): for each CFG edge A->S where S does not
+ * post-dominate A, the blocks from S up to, but excluding, the immediate
+ * post-dominator of A depend on the terminator of A.
+ *
+ * The influence region of a branch, which bSSA and hammock used to find by
+ * flooding the CFG until a post-dominator was reached, is the set of blocks that
+ * transitively depend on it.
+ */
+class ControlDependence : public FunctionPass {
+	private:
+		//Blocks directly control dependent on the terminator of each block, in CFG order
+		DenseMap<BasicBlock*, std::vector<BasicBlock*> > dependents;
+
+		void addDependents(BasicBlock* A, BasicBlock* S, PostDominatorTree &PD,
+				SmallPtrSet<BasicBlock*, 32> &added);
+
+	public:
+		static char ID;
+		ControlDependence() :
+			FunctionPass(ID) {
+		}
+
+		bool runOnFunction(Function &F);
+		void getAnalysisUsage(AnalysisUsage &AU) const;
+		void releaseMemory();
+
+		//Blocks directly control dependent on the terminator of BB
+		const std::vector<BasicBlock*>& getDependents(BasicBlock* BB) const;
+
+		/*
+		 * The influence region of the terminator of BB, in discovery order, and
+		 * its exits: the blocks outside the region reached from BB or from the
+		 * region, i.e. where the flooding stopped. Blocks in noExpand are put in
+		 * the region but their own dependents are not followed.
+		 */
+		void getInfluenceRegion(BasicBlock* BB, std::vector<BasicBlock*> &region,
+				std::vector<BasicBlock*> &exits,
+				const SmallPtrSet<BasicBlock*, 32>* noExpand = NULL) const;
+};
+
+#endif
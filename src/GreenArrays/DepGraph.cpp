@@ -6,6 +6,41 @@ static cl::opt<bool, false> includeAllInstsInDepGraph(
 		"includeAllInstsInDepGraph",
 		cl::desc("Include All Instructions In DepGraph."), cl::NotHidden);
 
+static cl::opt<std::string> depGraphLoad("depGraphLoad",
+		cl::desc("Load the module dependence graph from a file written by -depGraphSave."),
+		cl::init(""));
+
+static cl::opt<std::string> depGraphSave("depGraphSave",
+		cl::desc("Write the module dependence graph to a binary file."),
+		cl::init(""));
+
+static cl::opt<bool> depGraphSummaries("depGraphSummaries",
+		cl::desc("Add summary edges from the inputs of each function to the results of its calls."),
+		cl::init(false));
+
+static cl::opt<bool> depGraphJSON("depGraphJSON",
+		cl::desc("Make -view-depgraph write line-delimited JSON instead of DOT."),
+		cl::init(false));
+
+static cl::list<std::string> depGraphSlice("depGraphSlice",
+		cl::desc("Make -view-depgraph write only the nodes around these named values."),
+		cl::CommaSeparated);
+
+static cl::opt<unsigned> depGraphHops("depGraphHops",
+		cl::desc("Distance of the nodes written around -depGraphSlice values."),
+		cl::init(2));
+
+static cl::list<edgeType> depGraphEdges("depGraphEdges",
+		cl::desc("Edge types written by -view-depgraph (all by default):"),
+		cl::values(clEnumValN(etData, "data", "Data dependences"),
+				clEnumValN(etControl, "control", "Control dependences"),
+				clEnumValN(etSummary, "summary", "Function summaries"),
+				clEnumValEnd), cl::CommaSeparated);
+
+cl::opt<unsigned> llvm::depGraphThreads("depGraphThreads",
+		cl::desc("Number of threads used to build the module dependence graph and to scan functions."),
+		cl::init(1));
+
 //*********************************************************************************************************************************************************************
 //                                                                                                                              DEPENDENCE GRAPH API
 //*********************************************************************************************************************************************************************
@@ -25,14 +60,15 @@ static cl::opt<bool, false> includeAllInstsInDepGraph(
  * Class GraphNode
  */
 
+//IDs are taken atomically because subgraphs may be built concurrently (see Graph::addFunctions)
 GraphNode::GraphNode() {
 	Class_ID = 0;
-	ID = currentID++;
+	ID = sys::AtomicIncrement(&currentID) - 1;
 }
 
 GraphNode::GraphNode(GraphNode &G) {
 	Class_ID = 0;
-	ID = currentID++;
+	ID = sys::AtomicIncrement(&currentID) - 1;
 }
 
 GraphNode::~GraphNode() {
@@ -79,6 +115,10 @@ int llvm::GraphNode::getId() const {
 	return ID;
 }
 
+unsigned llvm::GraphNode::getNumIds() {
+	return currentID;
+}
+
 bool llvm::GraphNode::hasSuccessor(GraphNode* succ) {
 	return successors.count(succ) > 0;
 }
@@ -87,6 +127,22 @@ bool llvm::GraphNode::hasPredecessor(GraphNode* pred) {
 	return predecessors.count(pred) > 0;
 }
 
+GraphNode::edge_iterator llvm::GraphNode::succ_begin() {
+	return successors.begin();
+}
+
+GraphNode::edge_iterator llvm::GraphNode::succ_end() {
+	return successors.end();
+}
+
+GraphNode::edge_iterator llvm::GraphNode::pred_begin() {
+	return predecessors.begin();
+}
+
+GraphNode::edge_iterator llvm::GraphNode::pred_end() {
+	return predecessors.end();
+}
+
 std::string llvm::GraphNode::getName() {
 	std::ostringstream stringStream;
 	stringStream << "node_" << getId();
@@ -97,7 +153,7 @@ std::string llvm::GraphNode::getStyle() {
 	return std::string("solid");
 }
 
-int llvm::GraphNode::currentID = 0;
+sys::cas_flag llvm::GraphNode::currentID = 0;
 
 /*
  * Class OpNode
@@ -428,52 +484,8 @@ void Graph::toDot(std::string s, const std::string fileName) {
 
 void Graph::toDot(std::string s, raw_ostream *stream) {
 
-	(*stream) << "digraph \"DFG for \'" << s << "\' function \"{\n";
-	(*stream) << "label=\"DFG for \'" << s << "\' function\";\n";
-
-	std::map<GraphNode*, int> DefinedNodes;
-
-	for (std::set<GraphNode*>::iterator node = nodes.begin(), end = nodes.end(); node
-			!= end; node++) {
-
-		if (DefinedNodes.count(*node) == 0) {
-			(*stream) << (*node)->getName() << "[shape=" << (*node)->getShape()
-					<< ",style=" << (*node)->getStyle() << ",label=\""
-					<< (*node)->getLabel() << "\"]\n";
-			DefinedNodes[*node] = 1;
-		}
-
-		std::map<GraphNode*, edgeType> succs = (*node)->getSuccessors();
-
-		for (std::map<GraphNode*, edgeType>::iterator succ = succs.begin(),
-				s_end = succs.end(); succ != s_end; succ++) {
-
-			if (DefinedNodes.count(succ->first) == 0) {
-				(*stream) << (succ->first)->getName() << "[shape="
-						<< (succ->first)->getShape() << ",style="
-						<< (succ->first)->getStyle() << ",label=\""
-						<< (succ->first)->getLabel() << "\"]\n";
-				DefinedNodes[succ->first] = 1;
-			}
-
-			//Source
-			(*stream) << "\"" << (*node)->getName() << "\"";
-
-			(*stream) << "->";
-
-			//Destination
-			(*stream) << "\"" << (succ->first)->getName() << "\"";
-
-			if (succ->second == etControl)
-				(*stream) << " [style=dashed]";
-
-			(*stream) << "\n";
-
-		}
-
-	}
-
-	(*stream) << "}\n\n";
+	ExportFilter filter;
+	exportGraph(s, stream, filter, efDot);
 
 }
 
@@ -506,6 +518,177 @@ void llvm::Graph::toDot(std::string s, raw_ostream *stream,
 	(*stream) << "}\n\n";
 }
 
+/*
+ * Class ExportFilter
+ */
+llvm::Graph::ExportFilter::ExportFilter() :
+	hops(0), edgeTypes(0) {
+}
+
+void llvm::Graph::ExportFilter::addNode(GraphNode* n) {
+	nodes.insert(n);
+}
+
+void llvm::Graph::ExportFilter::setHops(unsigned hops) {
+	this->hops = hops;
+}
+
+void llvm::Graph::ExportFilter::addEdgeType(edgeType type) {
+	edgeTypes |= 1 << type;
+}
+
+bool llvm::Graph::ExportFilter::acceptsEdge(edgeType type) const {
+	return edgeTypes == 0 || (edgeTypes & (1 << type));
+}
+
+std::set<GraphNode*> &llvm::Graph::ExportFilter::getNodes() {
+	return nodes;
+}
+
+unsigned llvm::Graph::ExportFilter::getHops() const {
+	return hops;
+}
+
+static std::string escapeJSON(std::string s) {
+
+	std::string result;
+
+	for (std::string::iterator c = s.begin(), cend = s.end(); c != cend; ++c) {
+		if (*c == '"' || *c == '\\')
+			result += '\\';
+		if ((unsigned char) *c >= ' ')
+			result += *c;
+	}
+
+	return result;
+}
+
+static const char* edgeTypeName(edgeType type) {
+
+	switch (type) {
+	case etControl:
+		return "control";
+	case etSummary:
+		return "summary";
+	default:
+		return "data";
+	}
+
+}
+
+void llvm::Graph::exportGraph(std::string s, const std::string fileName,
+		ExportFilter &filter, exportFormat format) {
+
+	std::string ErrorInfo;
+
+	raw_fd_ostream File(fileName.c_str(), ErrorInfo);
+
+	if (!ErrorInfo.empty()) {
+		errs() << "Error opening file " << fileName
+				<< " for writing! Error Info: " << ErrorInfo << " \n";
+		return;
+	}
+
+	exportGraph(s, &File, filter, format);
+
+}
+
+void llvm::Graph::exportGraph(std::string s, raw_ostream *stream,
+		ExportFilter &filter, exportFormat format) {
+
+	//The selected nodes: the whole graph, or the neighbourhood of the filter nodes
+	std::set<GraphNode*> slice;
+	std::set<GraphNode*> *selected = &nodes;
+
+	if (!filter.getNodes().empty()) {
+
+		std::vector<GraphNode*> frontier(filter.getNodes().begin(),
+				filter.getNodes().end());
+		slice.insert(frontier.begin(), frontier.end());
+
+		for (unsigned hop = 0; hop < filter.getHops() && !frontier.empty(); hop++) {
+
+			std::vector<GraphNode*> next;
+
+			for (std::vector<GraphNode*>::iterator n = frontier.begin(), nend =
+					frontier.end(); n != nend; ++n) {
+
+				for (std::map<GraphNode*, edgeType>::iterator succ =
+						(*n)->successors.begin(), s_end =
+						(*n)->successors.end(); succ != s_end; succ++) {
+					if (filter.acceptsEdge(succ->second) && slice.insert(
+							succ->first).second)
+						next.push_back(succ->first);
+				}
+
+				for (std::map<GraphNode*, edgeType>::iterator pred =
+						(*n)->predecessors.begin(), p_end =
+						(*n)->predecessors.end(); pred != p_end; pred++) {
+					if (filter.acceptsEdge(pred->second) && slice.insert(
+							pred->first).second)
+						next.push_back(pred->first);
+				}
+			}
+
+			frontier.swap(next);
+		}
+
+		selected = &slice;
+	}
+
+	if (format == efDot) {
+		(*stream) << "digraph \"DFG for \'" << s << "\' function \"{\n";
+		(*stream) << "label=\"DFG for \'" << s << "\' function\";\n";
+	}
+
+	//DOT accepts edges to nodes that are declared later, so each node is written once, with its edges
+	for (std::set<GraphNode*>::iterator node = selected->begin(), end =
+			selected->end(); node != end; node++) {
+
+		GraphNode* n = *node;
+
+		if (format == efDot) {
+			(*stream) << n->getName() << "[shape=" << n->getShape() << ",style="
+					<< n->getStyle() << ",label=\"" << n->getLabel() << "\"]\n";
+		} else {
+			(*stream) << "{\"node\":" << n->getId() << ",\"class\":"
+					<< n->getClass_Id() << ",\"label\":\"" << escapeJSON(
+					n->getLabel()) << "\",\"shape\":\"" << n->getShape()
+					<< "\",\"style\":\"" << n->getStyle() << "\"}\n";
+		}
+
+		for (std::map<GraphNode*, edgeType>::iterator succ =
+				n->successors.begin(), s_end = n->successors.end(); succ
+				!= s_end; succ++) {
+
+			//Without a slice every edge is written, as toDot always did, even to nodes missing from the node set
+			if (!filter.acceptsEdge(succ->second) || (selected != &nodes
+					&& !selected->count(succ->first)))
+				continue;
+
+			if (format == efDot) {
+				(*stream) << "\"" << n->getName() << "\"->\""
+						<< succ->first->getName() << "\"";
+
+				if (succ->second == etControl)
+					(*stream) << " [style=dashed]";
+				else if (succ->second == etSummary)
+					(*stream) << " [style=dotted]";
+
+				(*stream) << "\n";
+			} else {
+				(*stream) << "{\"src\":" << n->getId() << ",\"dst\":"
+						<< succ->first->getId() << ",\"type\":\""
+						<< edgeTypeName(succ->second) << "\"}\n";
+			}
+		}
+	}
+
+	if (format == efDot)
+		(*stream) << "}\n\n";
+
+}
+
 GraphNode* Graph::addInst(Value *v) {
 
 	GraphNode *Op, *Var, *Operand;
@@ -522,7 +705,8 @@ GraphNode* Graph::addInst(Value *v) {
 		 * However, if Var is a Pointer, maybe the memory node already exists but the
 		 * operation node aren't in the graph, yet. Thus we must process it.
 		 */
-		if (Var == NULL || (Var != NULL && findOpNode(v) == NULL)) { //If it has not processed yet
+		if ((Var == NULL || (Var != NULL && findOpNode(v) == NULL))
+				&& !droppedCallNodes.count(v)) { //If it has not processed yet
 
 			//If Var isn't NULL, we won't create another node for it
 			if (Var == NULL) {
@@ -542,6 +726,7 @@ GraphNode* Graph::addInst(Value *v) {
 					} else {
 						Var = new VarNode(v);
 						varNodes[v] = Var;
+						addFunctionValue(v);
 					}
 					nodes.insert(Var);
 				}
@@ -557,6 +742,7 @@ GraphNode* Graph::addInst(Value *v) {
 					Op = new OpNode(dyn_cast<Instruction> (v)->getOpcode(), v);
 				}
 				opNodes[v] = Op;
+				addFunctionValue(v);
 
 				nodes.insert(Op);
 				if (hasVarNode)
@@ -582,6 +768,198 @@ GraphNode* Graph::addInst(Value *v) {
 	return NULL;
 }
 
+void Graph::addFunctionValue(Value *v) {
+
+	if (Instruction* I = dyn_cast<Instruction> (v))
+		functionValues[I->getParent()->getParent()].insert(v);
+	else if (Argument* A = dyn_cast<Argument> (v))
+		functionValues[A->getParent()].insert(v);
+
+}
+
+void Graph::addFunction(Function *F) {
+
+	for (Function::iterator BBit = F->begin(), BBend = F->end(); BBit != BBend; ++BBit) {
+		for (BasicBlock::iterator Iit = BBit->begin(), Iend = BBit->end(); Iit
+				!= Iend; ++Iit) {
+			addInst(Iit);
+		}
+	}
+
+}
+
+struct ParallelForWork {
+	unsigned n;
+	void (*body)(unsigned, void*);
+	void* context;
+	volatile sys::cas_flag next;
+};
+
+static void* parallelForWorker(void *arg) {
+
+	ParallelForWork *work = (ParallelForWork*) arg;
+
+	while (true) {
+		unsigned i = sys::AtomicIncrement(&work->next) - 1;
+		if (i >= work->n)
+			break;
+
+		work->body(i, work->context);
+	}
+
+	return NULL;
+}
+
+void llvm::parallelFor(unsigned n, unsigned nThreads,
+		void (*body)(unsigned, void*), void* context) {
+
+	if (nThreads > n)
+		nThreads = n;
+
+	ParallelForWork work;
+	work.n = n;
+	work.body = body;
+	work.context = context;
+	work.next = 0;
+
+	std::vector<pthread_t> threads(nThreads > 1 ? nThreads - 1 : 0);
+	unsigned nStarted = 0;
+	for (; nStarted < threads.size(); nStarted++) {
+		if (pthread_create(&threads[nStarted], NULL, parallelForWorker, &work))
+			break;
+	}
+
+	//The calling thread works too, and finishes the job alone if no thread could be started
+	parallelForWorker(&work);
+
+	for (unsigned i = 0; i < nStarted; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/*
+ * Parallel construction of the dependence graph
+ *
+ * The function-local part of addInst never reaches instructions of other
+ * functions, so each function can be inserted into a private subgraph. The
+ * only nodes shared among functions are the VarNodes of constants and
+ * globals and the MemNodes of alias sets; they are unified when the
+ * subgraphs are merged.
+ */
+struct SubGraphWork {
+	std::vector<Function*> *functions;
+	std::vector<Graph*> *subGraphs;
+};
+
+static void buildSubGraph(unsigned i, void *arg) {
+
+	SubGraphWork *work = (SubGraphWork*) arg;
+	(*work->subGraphs)[i]->addFunction((*work->functions)[i]);
+}
+
+void Graph::addFunctions(std::vector<Function*> &functions, unsigned nThreads) {
+
+	if (nThreads > functions.size())
+		nThreads = functions.size();
+
+	if (nThreads <= 1) {
+		for (unsigned i = 0; i < functions.size(); i++)
+			addFunction(functions[i]);
+		return;
+	}
+
+	//The Graph constructor resets the edge counter
+	unsigned numEdges = NrEdges;
+	std::vector<Graph*> subGraphs;
+	for (unsigned i = 0; i < functions.size(); i++)
+		subGraphs.push_back(new Graph(AS));
+	NrEdges = numEdges;
+
+	sys::cas_flag firstID = GraphNode::currentID;
+
+	SubGraphWork work;
+	work.functions = &functions;
+	work.subGraphs = &subGraphs;
+	parallelFor(functions.size(), nThreads, buildSubGraph, &work);
+
+	//Renumber the nodes in function order, as a serial build would have done
+	GraphNode::currentID = firstID;
+
+	for (unsigned i = 0; i < subGraphs.size(); i++) {
+		mergeSubGraph(subGraphs[i]);
+		delete subGraphs[i];
+	}
+
+}
+
+static bool compareNodeIds(GraphNode* a, GraphNode* b) {
+	return a->getId() < b->getId();
+}
+
+void Graph::mergeSubGraph(Graph *sub) {
+
+	//Nodes of a subgraph are built by a single thread, so their IDs follow the creation order
+	std::vector<GraphNode*> subNodes(sub->nodes.begin(), sub->nodes.end());
+	std::sort(subNodes.begin(), subNodes.end(), compareNodeIds);
+
+	sub->nodes.clear();
+	sub->opNodes.clear();
+	sub->callNodes.clear();
+	sub->varNodes.clear();
+	sub->memNodes.clear();
+
+	//The values of a subgraph belong to its function only
+	for (DenseMap<Function*, std::set<Value*> >::iterator F =
+			sub->functionValues.begin(), Fend = sub->functionValues.end(); F
+			!= Fend; ++F)
+		functionValues[F->first].insert(F->second.begin(), F->second.end());
+	sub->functionValues.clear();
+
+	for (std::vector<GraphNode*>::iterator it = subNodes.begin(), end =
+			subNodes.end(); it != end; ++it) {
+
+		GraphNode* node = *it;
+		GraphNode* existing = NULL;
+
+		if (VarNode* VN = dyn_cast<VarNode>(node)) {
+			if (varNodes.count(VN->getValue()))
+				existing = varNodes[VN->getValue()];
+			else
+				varNodes[VN->getValue()] = node;
+		} else if (MemNode* MN = dyn_cast<MemNode>(node)) {
+			if (memNodes.count(MN->getAliasSetId()))
+				existing = memNodes[MN->getAliasSetId()];
+			else
+				memNodes[MN->getAliasSetId()] = node;
+		} else if (OpNode* ON = dyn_cast<OpNode>(node)) {
+			opNodes[ON->getValue()] = node;
+			if (CallNode* CN = dyn_cast<CallNode>(node))
+				callNodes[CN->getCallInst()] = node;
+		}
+
+		if (existing == NULL) {
+			node->ID = GraphNode::currentID++;
+			nodes.insert(node);
+			continue;
+		}
+
+		//The node is already in the graph: move its edges to the existing one
+		for (std::map<GraphNode*, edgeType>::iterator succ =
+				node->successors.begin(), s_end = node->successors.end(); succ
+				!= s_end; succ++) {
+			existing->connect(succ->first, succ->second);
+		}
+
+		for (std::map<GraphNode*, edgeType>::iterator pred =
+				node->predecessors.begin(), p_end = node->predecessors.end(); pred
+				!= p_end; pred++) {
+			pred->first->connect(existing, pred->second);
+		}
+
+		delete node;
+	}
+
+}
+
 void Graph::addEdge(GraphNode* src, GraphNode* dst, edgeType type) {
 
 	nodes.insert(src);
@@ -590,6 +968,43 @@ void Graph::addEdge(GraphNode* src, GraphNode* dst, edgeType type) {
 
 }
 
+GraphNode* Graph::addJoin(Function *F) {
+
+	if (GraphNode* join = findJoinNode(F))
+		return join;
+
+	GraphNode* join = new OpNode(Instruction::Call);
+	joinNodes[F] = join;
+	nodes.insert(join);
+
+	for (Function::iterator BB = F->begin(), endBB = F->end(); BB != endBB; ++BB) {
+		for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I != endI; ++I) {
+			if (GraphNode* node = findNode(I))
+				addEdge(join, node, etControl);
+		}
+	}
+
+	return join;
+}
+
+GraphNode* Graph::findJoinNode(Function *F) {
+
+	DenseMap<Function*, GraphNode*>::iterator it = joinNodes.find(F);
+	if (it == joinNodes.end())
+		return NULL;
+	return it->second;
+}
+
+void Graph::removeEdge(GraphNode* src, GraphNode* dst) {
+
+	if (src->successors.erase(dst)) {
+		dst->predecessors.erase(src);
+		NrEdges--;
+	}
+
+	summaryPaths.erase(std::make_pair(src, dst));
+}
+
 //It verify if the instruction is valid for the dependence graph, i.e. just data manipulator instructions are important for dependence graph
 bool Graph::isValidInst(Value *v) {
 
@@ -678,22 +1093,121 @@ void llvm::Graph::deleteCallNodes(Function* F) {
 		if (!isa<CallInst> (U))
 			continue;
 
-		Instruction *caller = cast<Instruction> (U);
+		deleteCallNode(cast<Instruction> (U));
 
-		if (callNodes.count(caller)) {
-			if (GraphNode* node = callNodes[caller]) {
-				nodes.erase(node);
-				delete node;
-			}
-			callNodes.erase(caller);
+	}
+
+}
+
+void llvm::Graph::deleteCallNode(Instruction* caller) {
+
+	if (callNodes.count(caller)) {
+		if (GraphNode* node = callNodes[caller]) {
+			nodes.erase(node);
+			delete node;
+		}
+		callNodes.erase(caller);
+		opNodes.erase(caller);
+
+		//The call must not be inserted again by addInst
+		droppedCallNodes.insert(caller);
+	}
+
+}
+
+void llvm::Graph::removeNode(GraphNode* node) {
+
+	//A path through a removed node belongs to a removed summary edge, too
+	for (std::map<GraphNode*, edgeType>::iterator succ =
+			node->successors.begin(), s_end = node->successors.end(); succ
+			!= s_end; succ++) {
+		if (succ->second == etSummary)
+			summaryPaths.erase(std::make_pair(node, succ->first));
+	}
+
+	for (std::map<GraphNode*, edgeType>::iterator pred =
+			node->predecessors.begin(), p_end = node->predecessors.end(); pred
+			!= p_end; pred++) {
+		if (pred->second == etSummary)
+			summaryPaths.erase(std::make_pair(pred->first, node));
+	}
+
+	nodes.erase(node);
+	delete node;
+
+}
+
+void llvm::Graph::removeFunction(Function* F) {
+
+	//The values F had when its nodes were built; the erased ones are only keys now
+	std::set<Value*> values;
+	DenseMap<Function*, std::set<Value*> >::iterator recorded =
+			functionValues.find(F);
+	if (recorded != functionValues.end()) {
+		values.swap(recorded->second);
+		functionValues.erase(recorded);
+	}
+
+	//Nodes shared with other functions, which may end up disconnected
+	std::set<GraphNode*> neighbours;
+
+	for (std::set<Value*>::iterator V = values.begin(), Vend = values.end(); V
+			!= Vend; ++V) {
+
+		GraphNode* owned[2] = { NULL, NULL };
+
+		if (opNodes.count(*V))
+			owned[0] = opNodes[*V];
+		if (varNodes.count(*V))
+			owned[1] = varNodes[*V];
+
+		opNodes.erase(*V);
+		callNodes.erase(*V);
+		varNodes.erase(*V);
+		droppedCallNodes.erase(*V);
+
+		for (unsigned i = 0; i < 2; i++) {
+			if (!owned[i])
+				continue;
+
+			for (std::map<GraphNode*, edgeType>::iterator succ =
+					owned[i]->successors.begin(), s_end =
+					owned[i]->successors.end(); succ != s_end; succ++)
+				neighbours.insert(succ->first);
+
+			for (std::map<GraphNode*, edgeType>::iterator pred =
+					owned[i]->predecessors.begin(), p_end =
+					owned[i]->predecessors.end(); pred != p_end; pred++)
+				neighbours.insert(pred->first);
+
+			neighbours.erase(owned[i]);
+			removeNode(owned[i]);
 		}
+	}
 
+	for (std::set<GraphNode*>::iterator N = neighbours.begin(), Nend =
+			neighbours.end(); N != Nend; ++N) {
+
+		GraphNode* node = *N;
+
+		if (!node->successors.empty() || !node->predecessors.empty())
+			continue;
+
+		if (MemNode* MN = dyn_cast<MemNode>(node)) {
+			memNodes.erase(MN->getAliasSetId());
+			removeNode(node);
+		} else if (VarNode* VN = dyn_cast<VarNode>(node)) {
+			if (!isa<Instruction>(VN->getValue()) && !isa<Argument>(VN->getValue())) {
+				varNodes.erase(VN->getValue());
+				removeNode(node);
+			}
+		}
 	}
 
 }
 
 std::pair<GraphNode*, int> llvm::Graph::getNearestDependency(llvm::Value* sink,
-		std::set<llvm::Value*> sources, bool skipMemoryNodes) {
+		std::set<llvm::Value*> sources, bool skipMemoryNodes, bool useSummaries) {
 
 	std::pair<llvm::GraphNode*, int> result;
 	result.first = NULL;
@@ -741,7 +1255,8 @@ std::pair<GraphNode*, int> llvm::Graph::getNearestDependency(llvm::Value* sink,
 
 			}
 
-			std::map<GraphNode*, edgeType> preds = workNode->getPredecessors();
+			std::map<GraphNode*, edgeType> preds = getPredecessors(workNode,
+					useSummaries);
 
 			for (std::map<GraphNode*, edgeType>::iterator pred = preds.begin(),
 					pend = preds.end(); pred != pend; pred++) {
@@ -766,7 +1281,8 @@ std::pair<GraphNode*, int> llvm::Graph::getNearestDependency(llvm::Value* sink,
 }
 
 std::map<GraphNode*, std::vector<GraphNode*> > llvm::Graph::getEveryDependency(
-		llvm::Value* sink, std::set<llvm::Value*> sources, bool skipMemoryNodes) {
+		llvm::Value* sink, std::set<llvm::Value*> sources, bool skipMemoryNodes,
+		bool useSummaries) {
 
 	std::map<llvm::GraphNode*, std::vector<GraphNode*> > result;
 	DenseMap<GraphNode*, GraphNode*> parent;
@@ -817,7 +1333,8 @@ std::map<GraphNode*, std::vector<GraphNode*> > llvm::Graph::getEveryDependency(
 				//                              errs() << "\n";
 				result[workNode] = path;
 			}
-			std::map<GraphNode*, edgeType> preds = workNode->getPredecessors();
+			std::map<GraphNode*, edgeType> preds = getPredecessors(workNode,
+					useSummaries);
 			for (std::map<GraphNode*, edgeType>::iterator pred = preds.begin(),
 					pend = preds.end(); pred != pend; pred++) {
 				if (nodeColor[pred->first] == 0) { // the node hasn't been processed yet
@@ -833,8 +1350,111 @@ std::map<GraphNode*, std::vector<GraphNode*> > llvm::Graph::getEveryDependency(
 	return result;
 }
 
-int llvm::Graph::getNumOpNodes() {
-	return opNodes.size();
+std::map<GraphNode*, edgeType> llvm::Graph::getPredecessors(GraphNode* n,
+		bool useSummaries) {
+
+	if (!useSummaries)
+		return n->predecessors;
+
+	bool hasSummary = false;
+	for (std::map<GraphNode*, edgeType>::iterator pred = n->predecessors.begin(),
+			pend = n->predecessors.end(); pred != pend && !hasSummary; pred++)
+		hasSummary = pred->second == etSummary;
+
+	if (!hasSummary)
+		return n->predecessors;
+
+	std::map<GraphNode*, edgeType> result;
+	for (std::map<GraphNode*, edgeType>::iterator pred = n->predecessors.begin(),
+			pend = n->predecessors.end(); pred != pend; pred++) {
+
+		//PHI of the return values, created by moduleDepGraph::matchCallSite
+		OpNode* ON = dyn_cast<OpNode>(pred->first);
+		if (pred->second == etData && ON && ON->getValue() == NULL
+				&& ON->getOpCode() == Instruction::PHI)
+			continue;
+
+		result.insert(*pred);
+	}
+
+	return result;
+}
+
+std::vector<GraphNode*> llvm::Graph::findPath(GraphNode* src, GraphNode* dst) {
+
+	std::vector<GraphNode*> path;
+	DenseMap<GraphNode*, GraphNode*> parent;
+	std::list<GraphNode*> workList;
+
+	parent[src] = NULL;
+	workList.push_back(src);
+
+	while (!workList.empty()) {
+		GraphNode* workNode = workList.front();
+		workList.pop_front();
+
+		if (workNode == dst) {
+			for (GraphNode* n = dst; n != NULL; n = parent[n])
+				path.push_back(n);
+			std::reverse(path.begin(), path.end());
+			break;
+		}
+
+		for (std::map<GraphNode*, edgeType>::iterator succ =
+				workNode->successors.begin(), s_end =
+				workNode->successors.end(); succ != s_end; succ++) {
+			if (succ->second != etSummary && !parent.count(succ->first)) {
+				parent[succ->first] = workNode;
+				workList.push_back(succ->first);
+			}
+		}
+	}
+
+	return path;
+}
+
+void llvm::Graph::setSummaryPath(GraphNode* src, GraphNode* dst,
+		std::vector<GraphNode*> &path) {
+
+	SummaryEdge e = std::make_pair(src, dst);
+	if (!summaryPaths.count(e))
+		summaryPaths[e] = path;
+}
+
+void llvm::Graph::expandPath(const std::vector<GraphNode*> &path,
+		std::set<SummaryEdge> &expanding, std::vector<GraphNode*> &expanded) {
+
+	for (unsigned i = 1; i < path.size(); i++) {
+
+		SummaryEdge e = std::make_pair(path[i - 1], path[i]);
+		std::map<SummaryEdge, std::vector<GraphNode*> >::iterator body =
+				summaryPaths.find(e);
+
+		//The path of a recursive call may go through the same summary edge: it is kept as is
+		if (body != summaryPaths.end() && expanding.insert(e).second) {
+			expandPath(body->second, expanding, expanded);
+			expanding.erase(e);
+		} else {
+			expanded.push_back(path[i]);
+		}
+	}
+}
+
+void llvm::Graph::expandSummaryEdges(std::vector<GraphNode*> &path) {
+
+	if (path.empty())
+		return;
+
+	std::vector<GraphNode*> expanded(1, path[0]);
+	std::set<SummaryEdge> expanding;
+
+	expandPath(path, expanding, expanded);
+
+	path.swap(expanded);
+}
+
+int llvm::Graph::getNumOpNodes() {
+	return opNodes.size();
 }
 
 int llvm::Graph::getNumCallNodes() {
@@ -880,6 +1500,403 @@ int llvm::Graph::getNumControlEdges() {
 	return getNumEdges(etControl);
 }
 
+int llvm::Graph::getNumSummaryEdges() {
+	return getNumEdges(etSummary);
+}
+
+/*
+ * Binary format
+ */
+static const char DepGraphMagic[8] = { 'D', 'E', 'P', 'G', 'R', 'A', 'P', 'H' };
+
+void llvm::MappedGraph::numberValues(Module &M, std::vector<Value*> &values) {
+
+	for (Module::global_iterator G = M.global_begin(), Gend = M.global_end(); G
+			!= Gend; ++G)
+		values.push_back(G);
+
+	for (Module::iterator F = M.begin(), Fend = M.end(); F != Fend; ++F)
+		values.push_back(F);
+
+	for (Module::iterator F = M.begin(), Fend = M.end(); F != Fend; ++F) {
+
+		for (Function::arg_iterator A = F->arg_begin(), Aend = F->arg_end(); A
+				!= Aend; ++A)
+			values.push_back(A);
+
+		for (Function::iterator BB = F->begin(), BBend = F->end(); BB != BBend; ++BB) {
+			for (BasicBlock::iterator I = BB->begin(), Iend = BB->end(); I
+					!= Iend; ++I) {
+				values.push_back(I);
+			}
+		}
+
+	}
+
+}
+
+uint32_t llvm::MappedGraph::hashValues(std::vector<Value*> &values) {
+
+	uint32_t hash = 0;
+
+	for (std::vector<Value*>::iterator V = values.begin(), Vend = values.end(); V
+			!= Vend; ++V) {
+		if (Instruction* I = dyn_cast<Instruction>(*V))
+			hash = hash * 31 + I->getOpcode() * 64 + I->getNumOperands();
+		else
+			hash = hash * 31 + (*V)->getValueID();
+	}
+
+	return hash;
+}
+
+bool llvm::MappedGraph::open(std::string fileName) {
+
+	header = NULL;
+
+	//Big files are mapped instead of read
+	if (error_code ec = MemoryBuffer::getFile(fileName, buffer, -1, false)) {
+		errs() << "Error opening file " << fileName
+				<< " for reading! Error Info: " << ec.message() << " \n";
+		return false;
+	}
+
+	const char* start = buffer->getBufferStart();
+	uint64_t size = buffer->getBufferSize();
+	const Header* H = (const Header*) start;
+
+	if (size < sizeof(Header) || memcmp(H->magic, DepGraphMagic, 8)
+			|| H->version != Version) {
+		errs() << "File " << fileName << " is not a dependence graph (version "
+				<< Version << ")\n";
+		return false;
+	}
+
+	uint64_t expectedSize = sizeof(Header) + (uint64_t) H->numNodes
+			* sizeof(Node) + ((uint64_t) H->numNodes + 1) * sizeof(uint32_t)
+			+ (uint64_t) H->numEdges * (sizeof(uint32_t) + sizeof(uint8_t));
+
+	if (size != expectedSize) {
+		errs() << "Dependence graph file " << fileName << " is truncated\n";
+		return false;
+	}
+
+	nodeTable = (const Node*) (start + sizeof(Header));
+	offsets = (const uint32_t*) (nodeTable + H->numNodes);
+	targets = offsets + H->numNodes + 1;
+	types = (const uint8_t*) (targets + H->numEdges);
+
+	bool consistent = offsets[0] == 0 && offsets[H->numNodes] == H->numEdges;
+	for (unsigned i = 0; consistent && i < H->numNodes; i++)
+		consistent = offsets[i] <= offsets[i + 1];
+	for (unsigned i = 0; consistent && i < H->numEdges; i++)
+		consistent = targets[i] < H->numNodes && types[i] <= etSummary;
+
+	if (!consistent) {
+		errs() << "Dependence graph file " << fileName << " is corrupted\n";
+		return false;
+	}
+
+	header = H;
+	return true;
+}
+
+unsigned llvm::MappedGraph::getNumValues() const {
+	return header->numValues;
+}
+
+unsigned llvm::MappedGraph::getModuleHash() const {
+	return header->moduleHash;
+}
+
+unsigned llvm::MappedGraph::getNumNodes() const {
+	return header->numNodes;
+}
+
+unsigned llvm::MappedGraph::getNumEdges() const {
+	return header->numEdges;
+}
+
+const MappedGraph::Node& llvm::MappedGraph::getNode(unsigned i) const {
+	return nodeTable[i];
+}
+
+const uint32_t* llvm::MappedGraph::succBegin(unsigned i) const {
+	return targets + offsets[i];
+}
+
+const uint32_t* llvm::MappedGraph::succEnd(unsigned i) const {
+	return targets + offsets[i + 1];
+}
+
+edgeType llvm::MappedGraph::getEdgeType(const uint32_t* succ) const {
+	return (edgeType) types[succ - targets];
+}
+
+bool llvm::Graph::writeBinary(Module &M, std::string fileName,
+		const PHIOwnerMap *owners) {
+
+	std::vector<Value*> values;
+	MappedGraph::numberValues(M, values);
+
+	//Handles of the values: their position in the module, or the first operand that uses them
+	//(second is 0 for the value itself, or the operand number plus one)
+	DenseMap<Value*, std::pair<uint32_t, uint32_t> > handles;
+	for (uint32_t i = 0; i < values.size(); i++)
+		handles[values[i]] = std::make_pair(i, 0u);
+
+	for (uint32_t i = 0; i < values.size(); i++) {
+		if (Instruction* I = dyn_cast<Instruction>(values[i])) {
+			for (uint32_t op = 0; op < I->getNumOperands(); op++) {
+				Value* v = I->getOperand(op);
+				if (v && !handles.count(v))
+					handles[v] = std::make_pair(i, op + 1);
+			}
+		}
+	}
+
+	//MemNodes are stored with one of their values, so the alias set can be found again
+	DenseMap<int, Value*> representatives;
+	if (USE_ALIAS_SETS && AS) {
+		DenseMap<int, std::set<Value*> > sets = AS->getValueSets();
+		for (DenseMap<int, std::set<Value*> >::iterator S = sets.begin(), Send =
+				sets.end(); S != Send; ++S) {
+			for (std::set<Value*>::iterator V = S->second.begin(), Vend =
+					S->second.end(); V != Vend; ++V) {
+				if (handles.count(*V) && (!representatives.count(S->first)
+						|| handles[*V] < handles[representatives[S->first]]))
+					representatives[S->first] = *V;
+			}
+		}
+	}
+
+	std::vector<GraphNode*> sortedNodes(nodes.begin(), nodes.end());
+	std::sort(sortedNodes.begin(), sortedNodes.end(), compareNodeIds);
+
+	DenseMap<GraphNode*, uint32_t> index;
+	for (uint32_t i = 0; i < sortedNodes.size(); i++)
+		index[sortedNodes[i]] = i;
+
+	std::vector<MappedGraph::Node> nodeTable(sortedNodes.size());
+	std::vector<uint32_t> offsets(1, 0);
+	std::vector<uint32_t> targets;
+	std::vector<uint8_t> types;
+
+	for (uint32_t i = 0; i < sortedNodes.size(); i++) {
+
+		GraphNode* node = sortedNodes[i];
+		MappedGraph::Node &N = nodeTable[i];
+		Value* v = NULL;
+
+		N.kind = node->getClass_Id();
+		N.data = 0;
+
+		if (OpNode* ON = dyn_cast<OpNode>(node)) {
+			N.data = ON->getOpCode();
+			v = ON->getValue();
+		} else if (VarNode* VN = dyn_cast<VarNode>(node)) {
+			v = VN->getValue();
+		} else if (MemNode* MN = dyn_cast<MemNode>(node)) {
+			N.data = MN->getAliasSetId();
+			if (representatives.count(MN->getAliasSetId()))
+				v = representatives[MN->getAliasSetId()];
+		}
+
+		N.valueKind = MappedGraph::vkNone;
+		N.valueIndex = 0;
+		N.operand = 0;
+		if (owners && owners->count(node)) {
+			//Functions and call sites always have a position in the module
+			std::pair<Value*, unsigned> owner = owners->lookup(node);
+			N.valueKind = isa<Function> (owner.first) ? MappedGraph::vkFormal
+					: MappedGraph::vkReturn;
+			N.valueIndex = handles[owner.first].first;
+			N.operand = owner.second;
+		} else if (v && handles.count(v)) {
+			std::pair<uint32_t, uint32_t> handle = handles[v];
+			N.valueIndex = handle.first;
+			if (handle.second == 0) {
+				N.valueKind = MappedGraph::vkValue;
+			} else {
+				N.valueKind = MappedGraph::vkOperand;
+				N.operand = handle.second - 1;
+			}
+		}
+
+		std::vector<std::pair<uint32_t, uint8_t> > succs;
+		for (std::map<GraphNode*, edgeType>::iterator succ =
+				node->successors.begin(), s_end = node->successors.end(); succ
+				!= s_end; succ++) {
+			if (index.count(succ->first))
+				succs.push_back(std::make_pair(index[succ->first],
+						(uint8_t) succ->second));
+		}
+		std::sort(succs.begin(), succs.end());
+
+		for (unsigned j = 0; j < succs.size(); j++) {
+			targets.push_back(succs[j].first);
+			types.push_back(succs[j].second);
+		}
+		offsets.push_back(targets.size());
+	}
+
+	MappedGraph::Header H;
+	memcpy(H.magic, DepGraphMagic, 8);
+	H.version = MappedGraph::Version;
+	H.numValues = values.size();
+	H.moduleHash = MappedGraph::hashValues(values);
+	H.numNodes = nodeTable.size();
+	H.numEdges = targets.size();
+
+	std::string ErrorInfo;
+	raw_fd_ostream File(fileName.c_str(), ErrorInfo);
+
+	if (!ErrorInfo.empty()) {
+		errs() << "Error opening file " << fileName
+				<< " for writing! Error Info: " << ErrorInfo << " \n";
+		return false;
+	}
+
+	File.write((const char*) &H, sizeof(H));
+	if (!nodeTable.empty())
+		File.write((const char*) &nodeTable[0],
+				nodeTable.size() * sizeof(MappedGraph::Node));
+	File.write((const char*) &offsets[0], offsets.size() * sizeof(uint32_t));
+	if (!targets.empty()) {
+		File.write((const char*) &targets[0], targets.size() * sizeof(uint32_t));
+		File.write((const char*) &types[0], types.size() * sizeof(uint8_t));
+	}
+
+	return true;
+}
+
+bool llvm::Graph::readBinary(Module &M, std::string fileName,
+		PHIOwnerMap *owners) {
+
+	MappedGraph MG;
+	if (!MG.open(fileName))
+		return false;
+
+	std::vector<Value*> values;
+	MappedGraph::numberValues(M, values);
+
+	if (values.size() != MG.getNumValues() || MappedGraph::hashValues(values)
+			!= MG.getModuleHash()) {
+		errs() << "Dependence graph file " << fileName
+				<< " was written for another module\n";
+		return false;
+	}
+
+	//Resolve every value before creating any node, so a bad file leaves the graph untouched
+	unsigned numNodes = MG.getNumNodes();
+	std::vector<Value*> nodeValues(numNodes, (Value*) NULL);
+	std::vector<Value*> nodeOwners(numNodes, (Value*) NULL);
+
+	for (unsigned i = 0; i < numNodes; i++) {
+
+		const MappedGraph::Node &N = MG.getNode(i);
+		Value* v = NULL;
+		bool valid = N.kind >= 1 && N.kind <= 4 && N.valueKind
+				<= MappedGraph::vkReturn;
+
+		if (valid && N.valueKind != MappedGraph::vkNone) {
+			valid = N.valueIndex < values.size();
+			if (valid && N.valueKind >= MappedGraph::vkFormal)
+				nodeOwners[i] = values[N.valueIndex];
+			else if (valid)
+				v = values[N.valueIndex];
+		}
+
+		//The PHI nodes of the formal parameters and return values are OpNodes without a value
+		if (valid && N.valueKind == MappedGraph::vkFormal) {
+			Function* F = dyn_cast<Function> (nodeOwners[i]);
+			valid = N.kind == 1 && F && N.operand < F->arg_size();
+		} else if (valid && N.valueKind == MappedGraph::vkReturn) {
+			valid = N.kind == 1 && (isa<CallInst> (nodeOwners[i]) || isa<
+					InvokeInst> (nodeOwners[i]));
+		}
+
+		if (valid && N.valueKind == MappedGraph::vkOperand) {
+			User* U = dyn_cast<User>(v);
+			valid = U && N.operand < U->getNumOperands();
+			v = valid ? U->getOperand(N.operand) : NULL;
+		}
+
+		//VarNodes need a value and CallNodes need their call instruction
+		if ((N.kind == 2 && !v) || (N.kind == 3 && !(v && isa<CallInst>(v))))
+			valid = false;
+
+		if (!valid) {
+			errs() << "Dependence graph file " << fileName
+					<< " has an invalid node (" << i << ")\n";
+			return false;
+		}
+
+		nodeValues[i] = v;
+	}
+
+	std::vector<GraphNode*> created(numNodes);
+
+	for (unsigned i = 0; i < numNodes; i++) {
+
+		const MappedGraph::Node &N = MG.getNode(i);
+		Value* v = nodeValues[i];
+		GraphNode* node;
+
+		switch (N.kind) {
+		case 1:
+			node = new OpNode(N.data, v);
+			if (v) {
+				opNodes[v] = node;
+				addFunctionValue(v);
+			}
+			break;
+		case 2:
+			node = new VarNode(v);
+			varNodes[v] = node;
+			addFunctionValue(v);
+			break;
+		case 3:
+			node = new CallNode(cast<CallInst>(v));
+			opNodes[v] = node;
+			callNodes[v] = node;
+			addFunctionValue(v);
+			break;
+		default: {
+			//Alias set IDs may differ among runs, so look the set up again
+			int aliasSetID = N.data;
+			if (USE_ALIAS_SETS && AS && v)
+				aliasSetID = AS->getValueSetKey(v);
+			node = new MemNode(aliasSetID, AS);
+			memNodes[aliasSetID] = node;
+		}
+		}
+
+		nodes.insert(node);
+		created[i] = node;
+
+		if (owners && nodeOwners[i])
+			(*owners)[node] = std::make_pair(nodeOwners[i], N.operand);
+	}
+
+	for (unsigned i = 0; i < numNodes; i++) {
+		for (const uint32_t *succ = MG.succBegin(i), *s_end = MG.succEnd(i); succ
+				!= s_end; ++succ) {
+			created[i]->connect(created[*succ], MG.getEdgeType(succ));
+		}
+	}
+
+	//Calls without an OpNode had their CallNode deleted when the graph was built
+	for (unsigned i = 0; i < values.size(); i++) {
+		if (isa<CallInst>(values[i]) && !opNodes.count(values[i])) {
+			droppedCallNodes.insert(values[i]);
+			addFunctionValue(values[i]);
+		}
+	}
+
+	return true;
+}
+
 //*********************************************************************************************************************************************************************
 //                                                                                                                              DEPENDENCE GRAPH CLIENT
 //*********************************************************************************************************************************************************************
@@ -911,12 +1928,7 @@ bool functionDepGraph::runOnFunction(Function &F) {
 	//Making dependency graph
 	depGraph = new llvm::Graph(AS);
 	//Insert instructions in the graph
-	for (Function::iterator BBit = F.begin(), BBend = F.end(); BBit != BBend; ++BBit) {
-		for (BasicBlock::iterator Iit = BBit->begin(), Iend = BBit->end(); Iit
-				!= Iend; ++Iit) {
-			depGraph->addInst(Iit);
-		}
-	}
+	depGraph->addFunction(&F);
 
 	//We don't modify anything, so we must return false
 	return false;
@@ -944,17 +1956,28 @@ bool moduleDepGraph::runOnModule(Module &M) {
 	//Making dependency graph
 	depGraph = new Graph(AS);
 
+	//Reuse the graph of a previous run, if it was built for this module
+	Graph::PHIOwnerMap owners;
+	if (!depGraphLoad.empty() && depGraph->readBinary(M, depGraphLoad, &owners)) {
+
+		//The PHI nodes are needed to update the graph and to summarize functions
+		setPHIOwners(M, owners);
+
+		if (depGraphSummaries)
+			computeSummaries(M);
+
+		return false;
+	}
+
 	//Insert instructions in the graph
+	std::vector<Function*> functions;
 	for (Module::iterator Fit = M.begin(), Fend = M.end(); Fit != Fend; ++Fit) {
-		for (Function::iterator BBit = Fit->begin(), BBend = Fit->end(); BBit
-				!= BBend; ++BBit) {
-			for (BasicBlock::iterator Iit = BBit->begin(), Iend = BBit->end(); Iit
-					!= Iend; ++Iit) {
-				depGraph->addInst(Iit);
-			}
-		}
+		if (Fit->begin() != Fit->end())
+			functions.push_back(Fit);
 	}
 
+	depGraph->addFunctions(functions, depGraphThreads);
+
 	//Connect formal and actual parameters and return values
 	for (Module::iterator Fit = M.begin(), Fend = M.end(); Fit != Fend; ++Fit) {
 
@@ -967,6 +1990,14 @@ bool moduleDepGraph::runOnModule(Module &M) {
 
 	}
 
+	if (depGraphSummaries)
+		computeSummaries(M);
+
+	if (!depGraphSave.empty()) {
+		getPHIOwners(owners);
+		depGraph->writeBinary(M, depGraphSave, &owners);
+	}
+
 	//We don't modify anything, so we must return false
 	return false;
 }
@@ -978,18 +2009,14 @@ void moduleDepGraph::matchParametersAndReturnValues(Function &F) {
 		return;
 	}
 
-	// Data structure which contains the matches between formal and real parameters
-	// First: formal parameter
-	// Second: real parameter
-	SmallVector<std::pair<GraphNode*, GraphNode*>, 4> Parameters(F.arg_size());
-
-	// Fetch the function arguments (formal parameters) into the data structure
 	Function::arg_iterator argptr;
 	Function::arg_iterator e;
-	unsigned i;
 
 	//Create the PHI nodes for the formal parameters
-	for (i = 0, argptr = F.arg_begin(), e = F.arg_end(); argptr != e; ++i, ++argptr) {
+	std::vector<GraphNode*> &Parameters = formalPHIs[&F];
+	Parameters.clear();
+
+	for (argptr = F.arg_begin(), e = F.arg_end(); argptr != e; ++argptr) {
 
 		OpNode* argPHI = new OpNode(Instruction::PHI);
 		GraphNode* argNode = NULL;
@@ -998,31 +2025,12 @@ void moduleDepGraph::matchParametersAndReturnValues(Function &F) {
 		if (argNode != NULL)
 			depGraph->addEdge(argPHI, argNode);
 
-		Parameters[i].first = argPHI;
+		Parameters.push_back(argPHI);
 	}
 
-	// Check if the function returns a supported value type. If not, no return value matching is done
-	bool noReturn = F.getReturnType()->isVoidTy();
-
 	// Creates the data structure which receives the return values of the function, if there is any
 	SmallPtrSet<llvm::Value*, 8> ReturnValues;
-
-	if (!noReturn) {
-		// Iterate over the basic blocks to fetch all possible return values
-		for (Function::iterator bb = F.begin(), bbend = F.end(); bb != bbend; ++bb) {
-			// Get the terminator instruction of the basic block and check if it's
-			// a return instruction: if it's not, continue to next basic block
-			Instruction *terminator = bb->getTerminator();
-
-			ReturnInst *RI = dyn_cast<ReturnInst> (terminator);
-
-			if (!RI)
-				continue;
-
-			// Get the return value and insert in the data structure
-			ReturnValues.insert(RI->getReturnValue());
-		}
-	}
+	getReturnValues(F, ReturnValues);
 
 	for (Value::use_iterator UI = F.use_begin(), E = F.use_end(); UI != E; ++UI) {
 		User *U = *UI;
@@ -1042,41 +2050,477 @@ void moduleDepGraph::matchParametersAndReturnValues(Function &F) {
 		if (!CS.isCallee(UI))
 			continue;
 
-		// Iterate over the real parameters and put them in the data structure
-		CallSite::arg_iterator AI;
-		CallSite::arg_iterator EI;
+		matchCallSite(F, caller, ReturnValues);
+	}
 
-		for (i = 0, AI = CS.arg_begin(), EI = CS.arg_end(); AI != EI; ++i, ++AI) {
-			Parameters[i].second = depGraph->addInst(*AI);
+	depGraph->deleteCallNodes(&F);
+}
+
+void moduleDepGraph::getPHIOwners(Graph::PHIOwnerMap &owners) {
+
+	for (DenseMap<Function*, std::vector<GraphNode*> >::iterator F =
+			formalPHIs.begin(), Fend = formalPHIs.end(); F != Fend; ++F) {
+		for (unsigned i = 0; i < F->second.size(); i++)
+			owners[F->second[i]] = std::make_pair((Value*) F->first, i);
+	}
+
+	for (DenseMap<Instruction*, GraphNode*>::iterator R = returnPHIs.begin(),
+			Rend = returnPHIs.end(); R != Rend; ++R)
+		owners[R->second] = std::make_pair((Value*) R->first, 0u);
+}
+
+void moduleDepGraph::setPHIOwners(Module &M, Graph::PHIOwnerMap &owners) {
+
+	for (Graph::PHIOwnerMap::iterator O = owners.begin(), Oend = owners.end(); O
+			!= Oend; ++O) {
+		if (Function* F = dyn_cast<Function> (O->second.first)) {
+			std::vector<GraphNode*> &Parameters = formalPHIs[F];
+			Parameters.resize(F->arg_size(), NULL);
+			Parameters[O->second.second] = O->first;
+		} else {
+			Instruction* caller = cast<Instruction> (O->second.first);
+			returnPHIs[caller] = O->first;
+			returnPHICalls[caller->getParent()->getParent()].insert(caller);
 		}
+	}
 
-		// Match formal and real parameters
-		for (i = 0; i < Parameters.size(); ++i) {
+	//PHI nodes without edges were not stored: create them again, as matchParametersAndReturnValues does
+	for (Module::iterator Fit = M.begin(), Fend = M.end(); Fit != Fend; ++Fit) {
 
-			depGraph->addEdge(Parameters[i].second, Parameters[i].first);
+		if (Fit->begin() == Fit->end() || Fit->isVarArg()
+				|| !Fit->hasNUsesOrMore(1))
+			continue;
+
+		std::vector<GraphNode*> &Parameters = formalPHIs[Fit];
+		Parameters.resize(Fit->arg_size(), NULL);
+		for (unsigned i = 0; i < Parameters.size(); i++) {
+			if (!Parameters[i])
+				Parameters[i] = new OpNode(Instruction::PHI);
 		}
+	}
+}
+
+void moduleDepGraph::getReturnValues(Function &F,
+		SmallPtrSet<Value*, 8> &ReturnValues) {
 
-		// Match return values
-		if (!noReturn) {
+	// Check if the function returns a supported value type. If not, no return value matching is done
+	if (F.getReturnType()->isVoidTy())
+		return;
 
-			OpNode* retPHI = new OpNode(Instruction::PHI);
-			GraphNode* callerNode = depGraph->addInst(caller);
-			depGraph->addEdge(retPHI, callerNode);
+	// Iterate over the basic blocks to fetch all possible return values
+	for (Function::iterator bb = F.begin(), bbend = F.end(); bb != bbend; ++bb) {
+		// Get the terminator instruction of the basic block and check if it's
+		// a return instruction: if it's not, continue to next basic block
+		Instruction *terminator = bb->getTerminator();
+
+		ReturnInst *RI = dyn_cast<ReturnInst> (terminator);
+
+		if (!RI)
+			continue;
 
-			for (SmallPtrSetIterator<llvm::Value*> ri = ReturnValues.begin(),
-					re = ReturnValues.end(); ri != re; ++ri) {
-				GraphNode* retNode = depGraph->addInst(*ri);
-				depGraph->addEdge(retNode, retPHI);
+		// Get the return value and insert in the data structure
+		ReturnValues.insert(RI->getReturnValue());
+	}
+}
+
+void moduleDepGraph::matchCallSite(Function &F, Instruction *caller,
+		SmallPtrSet<Value*, 8> &ReturnValues) {
+
+	std::vector<GraphNode*> &Parameters = formalPHIs[&F];
+
+	// Iterate over the real parameters and match them with the formal ones
+	CallSite CS(caller);
+	CallSite::arg_iterator AI;
+	CallSite::arg_iterator EI;
+	unsigned i;
+
+	for (i = 0, AI = CS.arg_begin(), EI = CS.arg_end(); AI != EI
+			&& i < Parameters.size(); ++i, ++AI) {
+		depGraph->addEdge(depGraph->addInst(*AI), Parameters[i]);
+	}
+
+	// Match return values
+	if (!F.getReturnType()->isVoidTy()) {
+
+		OpNode* retPHI = new OpNode(Instruction::PHI);
+		GraphNode* callerNode = depGraph->addInst(caller);
+		depGraph->addEdge(retPHI, callerNode);
+		returnPHIs[caller] = retPHI;
+		returnPHICalls[caller->getParent()->getParent()].insert(caller);
+
+		for (SmallPtrSetIterator<llvm::Value*> ri = ReturnValues.begin(), re =
+				ReturnValues.end(); ri != re; ++ri) {
+			GraphNode* retNode = depGraph->addInst(*ri);
+			depGraph->addEdge(retNode, retPHI);
+		}
+
+	}
+}
+
+void moduleDepGraph::updateFunction(Function &F) {
+
+	if (depGraphSummaries)
+		clearSummary(F);
+
+	//PHI nodes of the formal parameters of F
+	if (formalPHIs.count(&F)) {
+		std::vector<GraphNode*> &Parameters = formalPHIs[&F];
+		for (unsigned i = 0; i < Parameters.size(); i++)
+			depGraph->removeNode(Parameters[i]);
+		formalPHIs.erase(&F);
+	}
+
+	//PHI nodes of the return values of F at its call sites
+	for (Value::use_iterator UI = F.use_begin(), E = F.use_end(); UI != E; ++UI) {
+		if (Instruction *caller = dyn_cast<Instruction> (*UI)) {
+			if (returnPHIs.count(caller)) {
+				depGraph->removeNode(returnPHIs[caller]);
+				returnPHIs.erase(caller);
+				returnPHICalls[caller->getParent()->getParent()].erase(caller);
 			}
+		}
+	}
 
+	//PHI nodes of the return values of the calls made by F, erased ones included
+	if (returnPHICalls.count(&F)) {
+		std::set<Instruction*> &calls = returnPHICalls[&F];
+		for (std::set<Instruction*>::iterator I = calls.begin(), Iend =
+				calls.end(); I != Iend; ++I) {
+			if (returnPHIs.count(*I)) {
+				depGraph->removeNode(returnPHIs[*I]);
+				returnPHIs.erase(*I);
+			}
 		}
+		returnPHICalls.erase(&F);
+	}
+
+	depGraph->removeFunction(&F);
 
-		// Real parameters are cleaned before moving to the next use (for safety's sake)
-		for (i = 0; i < Parameters.size(); ++i)
-			Parameters[i].second = NULL;
+	if (F.begin() == F.end())
+		return;
+
+	depGraph->addFunction(&F);
+
+	//Match F with its call sites, including the ones inside F
+	matchParametersAndReturnValues(F);
+
+	//Match the calls made by F with their callees
+	std::set<Function*> callees;
+	for (Function::iterator BB = F.begin(), BBend = F.end(); BB != BBend; ++BB) {
+		for (BasicBlock::iterator I = BB->begin(), Iend = BB->end(); I != Iend; ++I) {
+
+			//Calls and invokes alike
+			CallSite CS(I);
+			if (!CS.getInstruction())
+				continue;
+
+			Function *Callee = CS.getCalledFunction();
+			if (!Callee || Callee == &F || Callee->begin() == Callee->end())
+				continue;
+
+			callees.insert(Callee);
+
+			//The callee had no call sites before: match all of them now
+			if (!formalPHIs.count(Callee)) {
+				matchParametersAndReturnValues(*Callee);
+				continue;
+			}
+
+			SmallPtrSet<llvm::Value*, 8> ReturnValues;
+			getReturnValues(*Callee, ReturnValues);
+
+			matchCallSite(*Callee, CS.getInstruction(), ReturnValues);
+			depGraph->deleteCallNode(CS.getInstruction());
+		}
 	}
 
-	depGraph->deleteCallNodes(&F);
+	if (!depGraphSummaries)
+		return;
+
+	//The call sites inside F lost their summary edges
+	std::vector<Function*> order(callees.begin(), callees.end());
+	order.push_back(&F);
+
+	//The callers of F, directly or not, may depend on other inputs now
+	std::set<Function*> visited;
+	std::list<Function*> workList;
+	visited.insert(&F);
+	workList.push_back(&F);
+
+	while (!workList.empty()) {
+		Function* Callee = workList.front();
+		workList.pop_front();
+
+		for (Value::use_iterator UI = Callee->use_begin(), E = Callee->use_end(); UI
+				!= E; ++UI) {
+			CallSite CS(*UI);
+			if (!CS.getInstruction() || !CS.isCallee(UI))
+				continue;
+
+			Function* Caller = CS.getInstruction()->getParent()->getParent();
+			if (visited.insert(Caller).second) {
+				clearSummary(*Caller);
+				order.push_back(Caller);
+				workList.push_back(Caller);
+			}
+		}
+	}
+
+	summarizeToFixpoint(order);
+}
+
+//The function whose argument or instruction n stands for, if any
+static Function* getNodeFunction(GraphNode* n) {
+	Value* v = NULL;
+	if (OpNode* op = dyn_cast<OpNode> (n))
+		v = op->getValue();
+	else if (VarNode* var = dyn_cast<VarNode> (n))
+		v = var->getValue();
+
+	if (!v)
+		return NULL;
+	if (Argument* A = dyn_cast<Argument> (v))
+		return A->getParent();
+	if (Instruction* I = dyn_cast<Instruction> (v))
+		return I->getParent()->getParent();
+	return NULL;
+}
+
+bool moduleDepGraph::summarizeFunction(Function &F) {
+
+	//Summaries are attached to the VarNodes of the call results
+	if (!formalPHIs.count(&F) || F.getReturnType()->isVoidTy()
+			|| F.getReturnType()->isPointerTy())
+		return false;
+
+	std::vector<GraphNode*> &Parameters = formalPHIs[&F];
+	std::set<GraphNode*> ownPHIs(Parameters.begin(), Parameters.end());
+
+	std::vector<GraphNode*> formals(F.arg_size(), (GraphNode*) NULL);
+	std::set<GraphNode*> inputs;
+
+	//Next node on the way from each visited node to a return value (NULL for the return values)
+	DenseMap<GraphNode*, GraphNode*> next;
+	std::list<GraphNode*> workList;
+
+	SmallPtrSet<llvm::Value*, 8> ReturnValues;
+	getReturnValues(F, ReturnValues);
+
+	for (SmallPtrSetIterator<llvm::Value*> ri = ReturnValues.begin(), re =
+			ReturnValues.end(); ri != re; ++ri) {
+		GraphNode* retNode = depGraph->findNode(*ri);
+		if (retNode && !next.count(retNode)) {
+			next[retNode] = NULL;
+			workList.push_back(retNode);
+		}
+	}
+
+	/*
+	 * Backward search from the return values. It stops at memory, at the
+	 * arguments of F, at the nodes of other functions and at the nodes with
+	 * no predecessors (globals, for instance), and jumps over the callees
+	 * through their summary edges. Every stop but the arguments of F is an
+	 * input of the summary. A callee without summary edges yet (a recursive
+	 * one) adds nothing now: summarizeToFixpoint comes back to F when the
+	 * callee summary grows.
+	 */
+	while (!workList.empty()) {
+
+		GraphNode* workNode = workList.front();
+		workList.pop_front();
+
+		if (isa<MemNode> (workNode)) {
+			inputs.insert(workNode);
+			continue;
+		}
+
+		GraphNode* calleeReturn = NULL;
+
+		if (VarNode* VN = dyn_cast<VarNode> (workNode)) {
+			Value* v = VN->getValue();
+			if (Argument* A = dyn_cast<Argument> (v)) {
+				if (A->getParent() == &F) {
+					formals[A->getArgNo()] = workNode;
+					continue;
+				}
+			} else if (Instruction* I = dyn_cast<Instruction> (v)) {
+				CallSite CS(I);
+				Function* Callee = CS.getInstruction() ? CS.getCalledFunction()
+						: NULL;
+				if (CS.getInstruction() && (!Callee || Callee->begin()
+						== Callee->end()))
+					inputs.insert(workNode);
+				if (returnPHIs.count(I))
+					calleeReturn = returnPHIs[I];
+			}
+		}
+
+		if (ownPHIs.count(workNode))
+			continue;
+
+		//Whatever reaches a node of another function reaches F through it
+		Function* owner = getNodeFunction(workNode);
+		if (owner && owner != &F) {
+			inputs.insert(workNode);
+			continue;
+		}
+
+		std::map<GraphNode*, edgeType> preds = depGraph->getPredecessors(
+				workNode, true);
+
+		//Constants carry no input, so they are left out of the summary
+		Value* value = NULL;
+		if (VarNode* VN = dyn_cast<VarNode> (workNode))
+			value = VN->getValue();
+		if (preds.empty() && (!value || !isa<Constant> (value) || isa<GlobalValue> (value)))
+			inputs.insert(workNode);
+
+		for (std::map<GraphNode*, edgeType>::iterator pred = preds.begin(),
+				pend = preds.end(); pred != pend; pred++) {
+			if (pred->first != calleeReturn && !next.count(pred->first)) {
+				next[pred->first] = workNode;
+				workList.push_back(pred->first);
+			}
+		}
+	}
+
+	bool changed = false;
+
+	for (Value::use_iterator UI = F.use_begin(), E = F.use_end(); UI != E; ++UI) {
+
+		Instruction *caller = dyn_cast<Instruction> (*UI);
+		if (!caller || !returnPHIs.count(caller))
+			continue;
+
+		GraphNode* callerNode = depGraph->findNode(caller);
+		if (!callerNode || !isa<VarNode> (callerNode))
+			continue;
+
+		//The path behind each edge: input, the body of F, return PHI, call result
+		std::vector<GraphNode*> path;
+		GraphNode* retPHI = returnPHIs[caller];
+
+		CallSite CS(caller);
+		for (unsigned i = 0; i < formals.size() && i < CS.arg_size(); i++) {
+			if (!formals[i])
+				continue;
+
+			GraphNode* actual = depGraph->findNode(CS.getArgument(i));
+			if (!actual || actual->hasSuccessor(callerNode))
+				continue;
+
+			path.assign(1, actual);
+			path.push_back(Parameters[i]);
+			for (GraphNode* n = formals[i]; n != NULL; n = next[n])
+				path.push_back(n);
+			path.push_back(retPHI);
+			path.push_back(callerNode);
+
+			depGraph->addEdge(actual, callerNode, etSummary);
+			depGraph->setSummaryPath(actual, callerNode, path);
+			changed = true;
+		}
+
+		for (std::set<GraphNode*>::iterator in = inputs.begin(), inend =
+				inputs.end(); in != inend; ++in) {
+			if (*in == callerNode || (*in)->hasSuccessor(callerNode))
+				continue;
+
+			path.clear();
+			for (GraphNode* n = *in; n != NULL; n = next[n])
+				path.push_back(n);
+			path.push_back(retPHI);
+			path.push_back(callerNode);
+
+			depGraph->addEdge(*in, callerNode, etSummary);
+			depGraph->setSummaryPath(*in, callerNode, path);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void moduleDepGraph::clearSummary(Function &F) {
+
+	for (Value::use_iterator UI = F.use_begin(), E = F.use_end(); UI != E; ++UI) {
+
+		Instruction *caller = dyn_cast<Instruction> (*UI);
+		if (!caller || !returnPHIs.count(caller))
+			continue;
+
+		GraphNode* callerNode = depGraph->findNode(caller);
+		if (!callerNode)
+			continue;
+
+		std::map<GraphNode*, edgeType> preds = callerNode->getPredecessors();
+		for (std::map<GraphNode*, edgeType>::iterator pred = preds.begin(),
+				pend = preds.end(); pred != pend; pred++) {
+			if (pred->second == etSummary)
+				depGraph->removeEdge(pred->first, callerNode);
+		}
+	}
+}
+
+void moduleDepGraph::computeSummaries(Module &M) {
+
+	std::set<Function*> visited;
+	std::vector<Function*> order;
+
+	for (Module::iterator Fit = M.begin(), Fend = M.end(); Fit != Fend; ++Fit)
+		sortCallees(*Fit, visited, order);
+
+	summarizeToFixpoint(order);
+}
+
+void moduleDepGraph::sortCallees(Function &F, std::set<Function*> &visited,
+		std::vector<Function*> &order) {
+
+	if (!visited.insert(&F).second)
+		return;
+
+	for (Function::iterator BB = F.begin(), BBend = F.end(); BB != BBend; ++BB) {
+		for (BasicBlock::iterator I = BB->begin(), Iend = BB->end(); I != Iend; ++I) {
+			CallSite CS(I);
+			if (!CS.getInstruction())
+				continue;
+			if (Function *Callee = CS.getCalledFunction())
+				sortCallees(*Callee, visited, order);
+		}
+	}
+
+	order.push_back(&F);
+}
+
+void moduleDepGraph::summarizeToFixpoint(std::vector<Function*> &order) {
+
+	/*
+	 * Summaries only grow, so this ends. Functions outside call graph cycles
+	 * come after their callees and are summarized once; the ones in a cycle
+	 * are summarized again while the summaries of the cycle change.
+	 */
+	std::list<Function*> workList(order.begin(), order.end());
+	std::set<Function*> pending(order.begin(), order.end());
+
+	while (!workList.empty()) {
+		Function* F = workList.front();
+		workList.pop_front();
+		pending.erase(F);
+
+		if (!summarizeFunction(*F))
+			continue;
+
+		//New summary edges at the call sites of F: its callers may depend on more inputs
+		for (Value::use_iterator UI = F->use_begin(), E = F->use_end(); UI != E; ++UI) {
+			CallSite CS(*UI);
+			if (!CS.getInstruction() || !CS.isCallee(UI))
+				continue;
+
+			Function* Caller = CS.getInstruction()->getParent()->getParent();
+			if (pending.insert(Caller).second)
+				workList.push_back(Caller);
+		}
+	}
 }
 
 void llvm::moduleDepGraph::deleteCallNodes(Function* F) {
@@ -1084,7 +2528,7 @@ void llvm::moduleDepGraph::deleteCallNodes(Function* F) {
 }
 
 std::set<GraphNode*> llvm::Graph::getDepValues(std::set<llvm::Value*> sources,
-		bool forward) {
+		bool forward, bool useSummaries) {
 	unsigned long nnodes = nodes.size();
 	std::set<GraphNode*> visited;
 	std::set<GraphNode*> sourceNodes = findNodes(sources);
@@ -1101,7 +2545,7 @@ std::set<GraphNode*> llvm::Graph::getDepValues(std::set<llvm::Value*> sources,
 		if (forward)
 			neigh = n->getSuccessors();
 		else
-			neigh = n->getPredecessors();
+			neigh = getPredecessors(n, useSummaries);
 		for (std::map<GraphNode*, edgeType>::iterator i = neigh.begin(), e =
 				neigh.end(); i != e; ++i) {
 			if (!visited.count(i->first)) {
@@ -1114,6 +2558,29 @@ std::set<GraphNode*> llvm::Graph::getDepValues(std::set<llvm::Value*> sources,
 	return visited;
 }
 
+void llvm::Graph::getDepValues(std::set<llvm::Value*> sources,
+		BitVector &result, bool forward, bool useSummaries) {
+	result.clear();
+	result.resize(GraphNode::getNumIds());
+	std::set<GraphNode*> sourceNodes = findNodes(sources);
+	std::deque<GraphNode*> worklist(sourceNodes.begin(), sourceNodes.end());
+	while (!worklist.empty()) {
+		GraphNode* n = worklist.front();
+		worklist.pop_front();
+		std::map<GraphNode*, edgeType> preds;
+		if (!forward)
+			preds = getPredecessors(n, useSummaries);
+		std::map<GraphNode*, edgeType> &neigh = forward ? n->successors : preds;
+		for (std::map<GraphNode*, edgeType>::iterator i = neigh.begin(), e =
+				neigh.end(); i != e; ++i) {
+			if (!result.test(i->first->ID)) {
+				worklist.push_back(i->first);
+				result.set(i->first->ID);
+			}
+		}
+	}
+}
+
 llvm::Graph::Guider::Guider(Graph* graph) {
 	this->graph = graph;
 	std::set<GraphNode*> nodes = graph->getNodes();
@@ -1155,9 +2622,102 @@ std::string llvm::Graph::Guider::getEdgeAttrs(GraphNode* u, GraphNode* v) {
 }
 
 char moduleDepGraph::ID = 0;
+//Memory is named after its named aliases, the other nodes by their labels
+static std::string getSummaryInputName(GraphNode* n) {
+
+	MemNode* MN = dyn_cast<MemNode> (n);
+	if (!MN)
+		return n->getLabel();
+
+	std::set<std::string> names;
+	std::set<Value*> aliases = MN->getAliases();
+	for (std::set<Value*>::iterator a = aliases.begin(), aend = aliases.end(); a
+			!= aend; ++a) {
+		if ((*a)->hasName())
+			names.insert((*a)->getName().str());
+	}
+
+	std::string result = "memory(";
+	for (std::set<std::string>::iterator name = names.begin(), nend =
+			names.end(); name != nend; ++name) {
+		if (name != names.begin())
+			result += ",";
+		result += *name;
+	}
+	return result + ")";
+}
+
+void moduleDepGraph::print(raw_ostream &O, const Module *M) const {
+
+	for (DenseMap<Instruction*, GraphNode*>::const_iterator r =
+			returnPHIs.begin(), rend = returnPHIs.end(); r != rend; ++r) {
+
+		Instruction* caller = r->first;
+		GraphNode* callerNode = depGraph->findNode(caller);
+		if (!callerNode)
+			continue;
+
+		std::map<GraphNode*, edgeType> preds = callerNode->getPredecessors();
+		for (std::map<GraphNode*, edgeType>::iterator pred = preds.begin(),
+				pend = preds.end(); pred != pend; pred++) {
+			if (pred->second == etSummary)
+				O << caller->getParent()->getParent()->getName() << ": "
+						<< caller->getName() << " <- " << getSummaryInputName(
+						pred->first) << "\n";
+		}
+	}
+}
+
 static RegisterPass<moduleDepGraph> Y("moduleDepGraph",
 		"Module Dependence Graph");
 
+bool ViewModuleDepGraph::runOnModule(Module& M) {
+
+	moduleDepGraph& DepGraph = getAnalysis<moduleDepGraph> ();
+	Graph *g = DepGraph.depGraph;
+
+	std::string tmp = M.getModuleIdentifier();
+	replace(tmp.begin(), tmp.end(), '\\', '_');
+
+	std::string Filename = "/tmp/" + tmp + (depGraphJSON ? ".json" : ".dot");
+
+	Graph::ExportFilter filter;
+	filter.setHops(depGraphHops);
+
+	for (unsigned i = 0; i < depGraphEdges.size(); i++)
+		filter.addEdgeType(depGraphEdges[i]);
+
+	//Slice around the named values, if any
+	if (!depGraphSlice.empty()) {
+		std::set<std::string> names(depGraphSlice.begin(), depGraphSlice.end());
+		std::vector<Value*> values;
+		MappedGraph::numberValues(M, values);
+
+		for (std::vector<Value*>::iterator V = values.begin(), Vend =
+				values.end(); V != Vend; ++V) {
+			if (!(*V)->hasName() || !names.count((*V)->getName().str()))
+				continue;
+			if (GraphNode* node = g->findNode(*V))
+				filter.addNode(node);
+			if (GraphNode* node = g->findOpNode(*V))
+				filter.addNode(node);
+		}
+
+		if (filter.getNodes().empty()) {
+			errs() << "None of the values given to -depGraphSlice is in the graph\n";
+			return false;
+		}
+	}
+
+	//Print dependency graph
+	g->exportGraph(M.getModuleIdentifier(), Filename, filter,
+			depGraphJSON ? Graph::efJSON : Graph::efDot);
+
+	//                DisplayGraph(Filename, true, GraphProgram::DOT);
+
+	return false;
+}
+
 char ViewModuleDepGraph::ID = 0;
 static RegisterPass<ViewModuleDepGraph> Z("view-depgraph",
 		"View Module Dependence Graph");
@@ -6,29 +6,54 @@ InputDep::InputDep() :
 	ModulePass(ID) {
 }
 
-//TODO: Verify signature
+/*
+ * Finds the input calls of one function. It only reads the IR, so the
+ * functions of a module can be scanned on several threads.
+ */
+static void scanInputCalls(Function* F, std::vector<InputCall> &calls) {
+	SourceSinks &catalog = SourceSinks::get();
+	for (Function::iterator BB = F->begin(), e = F->end(); BB != e; ++BB) {
+		for (BasicBlock::iterator I = BB->begin(), ee = BB->end(); I != ee; ++I) {
+			CallInst *CI = dyn_cast<CallInst>(I);
+			if (!CI)
+				continue;
+			const CallRole* role = catalog.lookup(CI);
+			if (!role || role->role != crInput)
+				continue;
+			std::vector<Value*> values;
+			role->getValues(CI, values);
+			InputCall call;
+			call.CI = CI;
+			for (std::vector<Value*>::iterator V = values.begin(), VE =
+					values.end(); V != VE; ++V) {
+				//The returned value is the input itself; arguments must point to the buffers
+				if (*V == CI || (*V)->getType()->isPointerTy())
+					call.values.push_back(*V);
+			}
+			if (!call.values.empty())
+				calls.push_back(call);
+		}
+	}
+}
+
+struct InputScanWork {
+	std::vector<Function*> *functions;
+	std::vector<std::vector<InputCall> > *calls;
+};
+
+static void scanInputCallsWorker(unsigned i, void *arg) {
+	InputScanWork *work = (InputScanWork*) arg;
+	scanInputCalls((*work->functions)[i], (*work->calls)[i]);
+}
 
 /*
  * Main args are always input
- * Functions currently considered as input functions:
- * scanf
- * fscanf
- * gets
- * fgets
- * fread
- * fgetc
- * getc
- * getchar
- * recv
- * recvmsg
- * read
- * recvfrom
- * fread
+ * The other input functions (scanf, fgets, recv, ...) come from the
+ * input entries of the SourceSinks catalog.
  */
 bool InputDep::runOnModule(Module &M) {
 	//	DEBUG (errs() << "Function " << F.getName() << "\n";);
 	NumInputValues = 0;
-	bool inserted;
 	Function* main = M.getFunction("main");
 	if (main) {
 		MDNode *mdn = main->begin()->begin()->getMetadata("dbg");
@@ -45,92 +70,27 @@ bool InputDep::runOnModule(Module &M) {
 
 
 	}
-	for (Module::iterator F = M.begin(), eM = M.end(); F != eM; ++F) {
-		for (Function::iterator BB = F->begin(), e = F->end(); BB != e; ++BB) {
-			for (BasicBlock::iterator I = BB->begin(), ee = BB->end(); I != ee; ++I) {
-				if (CallInst *CI = dyn_cast<CallInst>(I)) {
-					Function *Callee = CI->getCalledFunction();
-					if (Callee) {
-						Value* V;
-						inserted = false;
-						StringRef Name = Callee->getName();
-						if (Name.equals("main")) {
-							errs() << "main\n";
-							V = CI->getArgOperand(1); //char* argv[]
-							inputDepValues.insert(V);
-							inserted = true;
-							//errs() << "Input    " << *V << "\n";
-						}
-						if (Name.equals("__isoc99_scanf") || Name.equals(
-								"scanf")) {
-							for (unsigned i = 1, eee = CI->getNumArgOperands(); i
-									!= eee; ++i) { // skip format string (i=1)
-								V = CI->getArgOperand(i);
-								if (V->getType()->isPointerTy()) {
-									inputDepValues.insert(V);
-									inserted = true;
-									//errs() << "Input    " << *V << "\n";
-								}
-							}
-						} else if (Name.equals("__isoc99_fscanf")
-								|| Name.equals("fscanf")) {
-							for (unsigned i = 2, eee = CI->getNumArgOperands(); i
-									!= eee; ++i) { // skip file pointer and format string (i=1)
-								V = CI->getArgOperand(i);
-								if (V->getType()->isPointerTy()) {
-									inputDepValues.insert(V);
-									inserted = true;
-									//errs() << "Input    " << *V << "\n";
-								}
-							}
-						} else if ((Name.equals("gets") || Name.equals("fgets")
-								|| Name.equals("fread"))
-								|| Name.equals("getwd")
-								|| Name.equals("getcwd")) {
-							V = CI->getArgOperand(0); //the first argument receives the input for these functions
-							if (V->getType()->isPointerTy()) {
-								inputDepValues.insert(V);
-								inserted = true;
-								//errs() << "Input    " << *V << "\n";
-							}
-						} else if ((Name.equals("fgetc") || Name.equals("getc")
-								|| Name.equals("getchar"))) {
-							inputDepValues.insert(CI);
-							inserted = true;
-							//errs() << "Input    " << *CI << "\n";
-						} else if (Name.equals("recv")
-								|| Name.equals("recvmsg")
-								|| Name.equals("read")) {
-							Value* V = CI->getArgOperand(1);
-							if (V->getType()->isPointerTy()) {
-								inputDepValues.insert(V);
-								inserted = true;
-								//errs() << "Input    " << *V << "\n";
-							}
-						} else if (Name.equals("recvfrom")) {
-							V = CI->getArgOperand(1);
-							if (V->getType()->isPointerTy()) {
-								inputDepValues.insert(V);
-								inserted = true;
-								//errs() << "Input    " << *V << "\n";
-							}
-							V = CI->getArgOperand(4);
-							if (V->getType()->isPointerTy()) {
-								inputDepValues.insert(V);
-								inserted = true;
-								//errs() << "Input    " << *V << "\n";
-							}
-						}
-						if (inserted) {
-							if (MDNode *mdn = I->getMetadata("dbg")) {
-								NumInputValues++;
-								DILocation Loc(mdn);
-								unsigned Line = Loc.getLineNumber();
-								lineNo[V] = Line;
-							}
-						}
-					}
-				}
+
+	//Scan the functions in parallel, then merge their calls in module order
+	SourceSinks::get().cacheFunctions(M);
+	std::vector<Function*> functions;
+	for (Module::iterator F = M.begin(), eM = M.end(); F != eM; ++F)
+		functions.push_back(F);
+	std::vector<std::vector<InputCall> > calls(functions.size());
+	InputScanWork work;
+	work.functions = &functions;
+	work.calls = &calls;
+	parallelFor(functions.size(), depGraphThreads, scanInputCallsWorker, &work);
+
+	for (unsigned f = 0; f < calls.size(); f++) {
+		for (std::vector<InputCall>::iterator call = calls[f].begin(), ce =
+				calls[f].end(); call != ce; ++call) {
+			inputDepValues.insert(call->values.begin(), call->values.end());
+			if (MDNode *mdn = call->CI->getMetadata("dbg")) {
+				NumInputValues++;
+				DILocation Loc(mdn);
+				unsigned Line = Loc.getLineNumber();
+				lineNo[call->values.back()] = Line;
 			}
 		}
 	}
@@ -17,11 +17,17 @@
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/IR/Function.h"
 #include "DepGraph.h"
+#include "SourceSinks.h"
 #include "llvm/ADT/StringRef.h"
 #include<set>
 
 using namespace llvm;
 
+//A call that reads input, and the values that receive it
+struct InputCall {
+	CallInst* CI;
+	std::vector<Value*> values;
+};
 
 class InputDep : public ModulePass {
 	private:
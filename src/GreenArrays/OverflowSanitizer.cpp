@@ -159,6 +159,8 @@ bool ::OverflowSanitizer::runOnModule(Module& M) {
 	insertGlobalDeclarations();
 
 	std::set<Value*> memAllocsOrInd; //keep track of memory allocation sizes and indices
+	SourceSinks &catalog = SourceSinks::get();
+	catalog.cacheFunctions(M);
 	//	Graph* graph = depGraph.depGraph;
 
 	for (Module::iterator F = M.begin(), endF = M.end(); F != endF; ++F) {
@@ -166,18 +168,8 @@ bool ::OverflowSanitizer::runOnModule(Module& M) {
 			for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I
 					!= endI; ++I) {
 				if (CallInst *CI = dyn_cast<CallInst> (I)) {
-					Function *FF = CI->getCalledFunction();
-					if (FF) {
-						StringRef name = FF->getName();
-						if (name == "malloc" || name == "realloc" || name
-								== "calloc" || name == "xalloc" || name
-								== "Znwj" || name == "ZnwjRKSt9nothrow_t"
-								|| name == "Znwm" || name
-								== "ZnwmRKSt9nothrow_t" || name == "Znaj"
-								|| name == "ZnajRKSt9nothrow_t" || name
-								== "Znam" || name == "ZnamRKSt9nothrow_t") {
-							memAllocsOrInd.insert(CI);
-						}
+					if (catalog.is(CI, crAlloc)) {
+						memAllocsOrInd.insert(CI);
 					}
 				} else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst> (I)) {
 					for (unsigned Idx = 1; Idx < GEP->getNumOperands(); ++Idx) {
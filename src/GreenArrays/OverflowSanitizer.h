@@ -32,6 +32,7 @@
 
 #include "InputValues.h"
 #include "DepGraph.h"
+#include "SourceSinks.h"
 #include "bSSA.h"
 
 using namespace llvm;
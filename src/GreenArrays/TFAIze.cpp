@@ -51,9 +51,6 @@ public:
 private:
   void setMetadataOn(Instruction *I); 
 
-  void visitStore(StoreInst *SI);
-  void visitLoad(LoadInst *LI);
-
   LLVMContext *Context_;
   TFA *TFA_;
 
@@ -78,18 +75,42 @@ bool AnnotateTainted::runOnModule(Module& M) {
   SafeLoads_   = 0;
   TotalLoads_  = 0;
 
+  // Collect every access not yet known to be safe, then ask TFA about all
+  // their pointers at once.
+  vector<Instruction*> Accesses;
+  vector<Value*> Pointers;
   for (auto& F : M)
     for (auto& BB : F)
       for (auto& I : BB)
         switch (I.getOpcode()) {
           case Instruction::Load:
-            visitLoad(cast<LoadInst>(&I));
+            TotalLoads_++;
+            if (!I.getMetadata("memsafe")) {
+              Accesses.push_back(&I);
+              Pointers.push_back(cast<LoadInst>(&I)->getPointerOperand());
+            }
             break;
           case Instruction::Store:
-            visitStore(cast<StoreInst>(&I));
+            TotalStores_++;
+            if (!I.getMetadata("memsafe")) {
+              Accesses.push_back(&I);
+              Pointers.push_back(cast<StoreInst>(&I)->getPointerOperand());
+            }
             break;
         }
 
+  BitVector Tainted;
+  TFA_->getTaintedValues(Pointers, Tainted);
+  for (unsigned i = 0; i < Accesses.size(); ++i) {
+    if (Tainted.test(i))
+      continue;
+    if (isa<LoadInst>(Accesses[i]))
+      SafeLoads_++;
+    else
+      SafeStores_++;
+    setMetadataOn(Accesses[i]);
+  }
+
   float PercentageSafeLoadsNum = (float)SafeLoads_/(float)TotalLoads_;
   ostringstream PercentageSafeLoadsStream; 
   PercentageSafeLoadsStream << setprecision(4) << PercentageSafeLoadsNum;
@@ -122,28 +143,6 @@ void AnnotateTainted::setMetadataOn(Instruction *I) {
   I->setMetadata("memsafe", MDNode::get(*Context_,  ArrayRef<Value*>()));
 }
 
-void AnnotateTainted::visitStore(StoreInst *SI) {
-  TotalStores_++;
-  if (SI->getMetadata("memsafe"))
-    return;
-  Value *Ptr = SI->getPointerOperand();
-  if (!TFA_->isValueTainted(Ptr)) {
-    SafeStores_++;
-    setMetadataOn(SI);
-  }
-}
-
-void AnnotateTainted::visitLoad(LoadInst *LI) {
-  TotalLoads_++;
-  if (LI->getMetadata("memsafe"))
-    return;
-  Value *Ptr = LI->getPointerOperand();
-  if (!TFA_->isValueTainted(Ptr)) {
-    SafeStores_++;
-    setMetadataOn(LI);
-  }
-}
-
 char AnnotateTainted::ID = 0;
 static RegisterPass<AnnotateTainted>
   R("tainted-annotate", "Annotate safe-to-dereference values",
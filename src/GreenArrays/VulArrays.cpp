@@ -9,6 +9,10 @@ STATISTIC(NumStores, "The number of store insts");
 STATISTIC(NumVulArraysAr, "The number of vulnerable contiguous arrays");
 STATISTIC(NumVulArraysSt, "The number of vulnerable arrays in structs");
 
+static cl::opt<bool> vulArraysSingleSweep("vulArraysSingleSweep",
+		cl::desc("Find the inputs of every array in a single sweep of the dependence graph"),
+		cl::init(false));
+
 VulArrays::VulArrays() :
 	ModulePass(ID) {
 	NumFuncArr = 0;
@@ -72,7 +76,7 @@ DenseMap<const Value*, std::vector<GraphNode*> > VulArrays::getValueDeps(
 				//				errs() << "Store inst found before ";
 				//				errs() << *V << "\n";
 				std::map<GraphNode*, std::vector<GraphNode*> > dep =
-						depGraph->getEveryDependency(V, inputDepValues, false);
+						depGraph->getEveryDependency(V, inputDepValues, false, true);
 				if (dep.begin() != dep.end()) {
 					//					errs() << "Dep found\n";
 					// Get debug info
@@ -90,6 +94,8 @@ DenseMap<const Value*, std::vector<GraphNode*> > VulArrays::getValueDeps(
 					}
 					for (std::map<GraphNode*, std::vector<GraphNode*> >::iterator
 							ii = dep.begin(), ee = dep.end(); ii != ee; ++ii) {
+						// Enter the callees skipped by summary edges
+						depGraph->expandSummaryEdges(ii->second);
 						if (VarNode * VN = dyn_cast<VarNode> (ii->first)) {
 							result[VN->getValue()] = ii->second;
 						} else if (MemNode * MN = dyn_cast<MemNode> (ii->first)) {
@@ -107,6 +113,166 @@ DenseMap<const Value*, std::vector<GraphNode*> > VulArrays::getValueDeps(
 	return result;
 }
 
+/*
+ * Function sweepFollows
+ *
+ * Return-value PHIs are not followed into call sites that have summary edges,
+ * as getEveryDependency does when it walks backwards.
+ */
+bool VulArrays::sweepFollows(GraphNode* n, GraphNode* succ) {
+	OpNode* ON = dyn_cast<OpNode>(n);
+	return !ON || ON->getValue() != NULL || ON->getOpCode() != Instruction::PHI
+			|| !sweepSummarized.count(succ);
+}
+
+/*
+ * Function sweepInputs
+ *
+ * Walks the graph forward from every input-dependent node at the same time,
+ * propagating the set of inputs that reach each node as a bit vector. A node
+ * is visited again only when its set grows, so the cost is the tainted part
+ * of the graph times the number of inputs over the word size, paid once
+ * for all the arrays. When an input first reaches a node, the node it came
+ * from is kept as its parent for that input, so getSweptDeps reads the paths
+ * without searching the graph again.
+ */
+void VulArrays::sweepInputs(std::set<Value*> &inputDepValues) {
+
+	std::set<GraphNode*> sources = depGraph->findNodes(inputDepValues);
+	sweepSources.assign(sources.begin(), sources.end());
+	sweepReach.clear();
+	sweepSummarized.clear();
+	sweepParents.clear();
+	sweepParents.resize(sweepSources.size());
+
+	for (Graph::iterator node = depGraph->begin(), nend = depGraph->end(); node
+			!= nend; ++node) {
+		for (GraphNode::edge_iterator succ = (*node)->succ_begin(), send =
+				(*node)->succ_end(); succ != send; ++succ) {
+			if (succ->second == etSummary)
+				sweepSummarized.insert(succ->first);
+		}
+	}
+
+	unsigned numSources = sweepSources.size();
+	std::deque<GraphNode*> workList;
+	SmallPtrSet<GraphNode*, 32> queued;
+
+	for (unsigned i = 0; i < numSources; i++) {
+		BitVector &reach = sweepReach[sweepSources[i]];
+		reach.resize(numSources);
+		reach.set(i);
+		workList.push_back(sweepSources[i]);
+		queued.insert(sweepSources[i]);
+	}
+
+	while (!workList.empty()) {
+		GraphNode* n = workList.front();
+		workList.pop_front();
+		queued.erase(n);
+
+		for (GraphNode::edge_iterator succ = n->succ_begin(), send =
+				n->succ_end(); succ != send; ++succ) {
+			if (!sweepFollows(n, succ->first))
+				continue;
+
+			//sweepReach may grow here, so the set of n is looked up after the one of succ
+			BitVector &reach = sweepReach[succ->first];
+			if (reach.empty())
+				reach.resize(numSources);
+
+			const BitVector &from = sweepReach[n];
+			if (!from.test(reach))
+				continue;
+
+			BitVector added = from;
+			added.reset(reach);
+			for (int i = added.find_first(); i != -1; i = added.find_next(i))
+				sweepParents[i][succ->first] = n;
+
+			reach |= from;
+			if (queued.insert(succ->first))
+				workList.push_back(succ->first);
+		}
+	}
+}
+
+/*
+ * Function getSweptDeps
+ *
+ * Same result as getValueDeps, read from the sets computed by sweepInputs.
+ * The path from each input that reaches the array follows the parents kept
+ * for that input by the sweep.
+ */
+DenseMap<const Value*, std::vector<GraphNode*> > VulArrays::getSweptDeps(
+		Value* V, std::set<Value*> &inputDepValues) {
+	DenseMap<const Value*, std::vector<GraphNode*> > result;
+
+	GraphNode* N = depGraph->findNode(V);
+	if (!N)
+		return result;
+
+	//Firstly, check if array or alias is passed as parameter to "any" lib function
+	if (MemNode* M = dyn_cast<MemNode> (N)) {
+		std::set<Value*> alias = M->getAliases();
+		for (std::set<Value*>::iterator ai = alias.begin(), aend = alias.end(); ai
+				!= aend; ++ai) {
+			if (inputDepValues.count(*ai))
+				result[V] = std::vector<GraphNode*>(1, depGraph->findNode(*ai));
+		}
+	}
+
+	//Secondly, check store operations targeting the array
+	bool hasStore = false;
+	std::map<GraphNode*, edgeType> pred = N->getPredecessors();
+	for (std::map<GraphNode*, edgeType>::iterator i = pred.begin(), endi =
+			pred.end(); i != endi; ++i) {
+		OpNode* ON = dyn_cast<OpNode> (i->first);
+		if (!ON || ON->getOpCode() != Instruction::Store)
+			continue;
+		hasStore = true;
+		if (!sweepReach.count(N) || ON->getValue() == NULL)
+			continue;
+		if (Instruction* I = dyn_cast<Instruction>(ON->getValue())) {
+			if (MDNode *mdn = I->getMetadata("dbg")) {
+				DILocation Loc(mdn);
+				debugInfo[std::make_pair(i->first, N)] = std::make_pair(
+						Loc.getLineNumber(), Loc.getFilename().str());
+			}
+		}
+	}
+	if (!hasStore || !sweepReach.count(N))
+		return result;
+
+	const BitVector &reach = sweepReach[N];
+	for (int i = reach.find_first(); i != -1; i = reach.find_next(i)) {
+		GraphNode* source = sweepSources[i];
+		DenseMap<GraphNode*, GraphNode*> &parents = sweepParents[i];
+
+		std::vector<GraphNode*> path;
+		for (GraphNode* p = N; p != source; p = parents[p])
+			path.push_back(p);
+		path.push_back(source);
+		std::reverse(path.begin(), path.end());
+		// Enter the callees skipped by summary edges
+		depGraph->expandSummaryEdges(path);
+
+		if (VarNode * VN = dyn_cast<VarNode> (source)) {
+			result[VN->getValue()] = path;
+		} else if (MemNode * MN = dyn_cast<MemNode> (source)) {
+			result[*MN->getAliases().begin()] = path; //get alias 0 as representative
+		}
+	}
+	return result;
+}
+
+DenseMap<const Value*, std::vector<GraphNode*> > VulArrays::findDeps(
+		Value* V, std::set<Value*> &inputDepValues) {
+	if (vulArraysSingleSweep)
+		return getSweptDeps(V, inputDepValues);
+	return getValueDeps(V, inputDepValues);
+}
+
 const Value* VulArrays::isValueInpDep(Value* V, std::set<Value*> inputDepValues) {
 	//Firstly, check if array or alias is passed as parameter to "any" lib function
 	std::set<Value*> alias;
@@ -138,7 +304,7 @@ const Value* VulArrays::isValueInpDep(Value* V, std::set<Value*> inputDepValues)
 			if (ON->getOpCode() == Instruction::Store) {
 				std::pair<GraphNode*, int> dep =
 						depGraph->getNearestDependency(ON->getValue(),
-								inputDepValues, false);
+								inputDepValues, false, true);
 				if (dep.first != NULL) {
 					if (VarNode * VN = dyn_cast<VarNode> (dep.first)) {
 						isDep[N] = VN->getValue();
@@ -158,91 +324,122 @@ const Value* VulArrays::isValueInpDep(Value* V, std::set<Value*> inputDepValues)
 	return NULL;
 }
 
-bool VulArrays::runOnModule(Module &M) {
-	//	InputValues &IV = getAnalysis<InputValues> ();
-	InputDep &IV = getAnalysis<InputDep> ();
-	AddStore &AS = getAnalysis<AddStore> ();
-	//		moduleDepGraph &m = getAnalysis<moduleDepGraph> ();
-	//		depGraph = m.depGraph;
-	depGraph = AS.getModifiedGraph();
-	DenseMap<Function*, bool> funcHasArray;
-	std::set<Value*> inputDepValues = IV.getInputDepValues();
-	for (Module::iterator F = M.begin(), endF = M.end(); F != endF; ++F) {
-		std::set<Value*> arrays;
-		for (Function::iterator BB = F->begin(), endBB = F->end(); BB != endBB; ++BB) {
-			NumFunc++;
-			for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I
-					!= endI; ++I) {
-				NumInsts++;
-				if (isa<StoreInst> (I))
-					NumStores++;
-				else if (AllocaInst* AI = dyn_cast<AllocaInst>(I)) {
-					Type* Ty = AI->getAllocatedType();
-					if (Ty->isArrayTy()) {
-						arrays.insert(AI);
-						NumArr++;
-						if (!funcHasArray[F]) {
-							funcHasArray[F] = true;
-							NumFuncArr++;
-						}
-					}
-				} else if (GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(I)) {
-					if (PointerType* PO = dyn_cast<PointerType>(GEP->getType())) {
-						if (PO->getElementType()->isArrayTy()) {
-							bool IsStruct = false;
-							while (isa<GetElementPtrInst> (
-									GEP->getPointerOperand())) {
-								IsStruct
-										= IsStruct
-												|| cast<PointerType> (
-														GEP->getPointerOperandType())->getElementType()->isStructTy();
-								GEP = cast<GetElementPtrInst> (
-										GEP->getPointerOperand());
-							}
+/*
+ * Collects the candidates of one function. It only reads the IR, so the
+ * functions of a module can be scanned on several threads.
+ */
+static void scanArrays(Function* F, ArrayScan &scan) {
+	scan.numBlocks = scan.numInsts = scan.numStores = 0;
+	for (Function::iterator BB = F->begin(), endBB = F->end(); BB != endBB; ++BB) {
+		scan.numBlocks++;
+		for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I
+				!= endI; ++I) {
+			scan.numInsts++;
+			if (isa<StoreInst> (I))
+				scan.numStores++;
+			else if (AllocaInst* AI = dyn_cast<AllocaInst>(I)) {
+				Type* Ty = AI->getAllocatedType();
+				if (Ty->isArrayTy())
+					scan.arrays.insert(AI);
+			} else if (GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(I)) {
+				if (PointerType* PO = dyn_cast<PointerType>(GEP->getType())) {
+					if (PO->getElementType()->isArrayTy()) {
+						bool IsStruct = false;
+						while (isa<GetElementPtrInst> (
+								GEP->getPointerOperand())) {
 							IsStruct
 									= IsStruct
 											|| cast<PointerType> (
 													GEP->getPointerOperandType())->getElementType()->isStructTy();
-							if (IsStruct) {
-								//								errs() << "Is struct\n";
-								if (AllocaInst *AI = dyn_cast<AllocaInst>(GEP->getPointerOperand())) {
-									DenseMap<const Value*, std::vector<
-											GraphNode*> > m = getValueDeps(GEP,
-											inputDepValues);
-									if (m.begin() != m.end()) {
-										//										depStructs1[F].insert(
-										//												std::make_pair(AI, v));
-										Structs1[depGraph->findNode(AI)] = m;
-										NumVulArrays++;
-										NumVulArraysSt++;
-									}
-								}
-							}
+							GEP = cast<GetElementPtrInst> (
+									GEP->getPointerOperand());
 						}
-					}
-				} else if (BitCastInst* BC = dyn_cast<BitCastInst>(I)) {
-					if (PointerType* PO = dyn_cast<PointerType>(BC->getSrcTy())) {
-						if (StructType* ST = dyn_cast<StructType>(PO->getElementType())) {
-							if (structHasArray(ST)) {
-								DenseMap<const Value*, std::vector<GraphNode*> >
-										m = getValueDeps(BC->getOperand(0),
-												inputDepValues);
-								if (m.begin() != m.end()) {
-									Structs2[depGraph->findNode(
-											BC->getOperand(0))] = m;
-								}
-							}
+						IsStruct
+								= IsStruct
+										|| cast<PointerType> (
+												GEP->getPointerOperandType())->getElementType()->isStructTy();
+						if (IsStruct) {
+							if (AllocaInst *AI = dyn_cast<AllocaInst>(GEP->getPointerOperand()))
+								scan.structGEPs.push_back(std::make_pair(GEP, AI));
 						}
 					}
 				}
+			} else if (BitCastInst* BC = dyn_cast<BitCastInst>(I)) {
+				if (PointerType* PO = dyn_cast<PointerType>(BC->getSrcTy())) {
+					if (StructType* ST = dyn_cast<StructType>(PO->getElementType())) {
+						if (VulArrays::structHasArray(ST))
+							scan.structCasts.push_back(BC->getOperand(0));
+					}
+				}
 			}
 		}
+	}
+}
+
+struct ArrayScanWork {
+	std::vector<Function*> *functions;
+	std::vector<ArrayScan> *scans;
+};
+
+static void scanArraysWorker(unsigned i, void *arg) {
+	ArrayScanWork *work = (ArrayScanWork*) arg;
+	scanArrays((*work->functions)[i], (*work->scans)[i]);
+}
+
+bool VulArrays::runOnModule(Module &M) {
+	//	InputValues &IV = getAnalysis<InputValues> ();
+	InputDep &IV = getAnalysis<InputDep> ();
+	AddStore &AS = getAnalysis<AddStore> ();
+	//		moduleDepGraph &m = getAnalysis<moduleDepGraph> ();
+	//		depGraph = m.depGraph;
+	depGraph = AS.getModifiedGraph();
+	std::set<Value*> inputDepValues = IV.getInputDepValues();
+	if (vulArraysSingleSweep)
+		sweepInputs(inputDepValues);
+
+	//Scan the functions in parallel; the graph is only queried afterwards, in module order
+	std::vector<Function*> functions;
+	for (Module::iterator F = M.begin(), endF = M.end(); F != endF; ++F)
+		functions.push_back(F);
+	std::vector<ArrayScan> scans(functions.size());
+	ArrayScanWork work;
+	work.functions = &functions;
+	work.scans = &scans;
+	parallelFor(functions.size(), depGraphThreads, scanArraysWorker, &work);
+
+	for (unsigned f = 0; f < scans.size(); f++) {
+		ArrayScan &scan = scans[f];
+		NumFunc += scan.numBlocks;
+		NumInsts += scan.numInsts;
+		NumStores += scan.numStores;
+		NumArr += scan.arrays.size();
+		if (!scan.arrays.empty())
+			NumFuncArr++;
+
+		for (std::vector<std::pair<GetElementPtrInst*, AllocaInst*> >::iterator
+				i = scan.structGEPs.begin(), e = scan.structGEPs.end(); i != e; ++i) {
+			DenseMap<const Value*, std::vector<GraphNode*> > m = findDeps(
+					i->first, inputDepValues);
+			if (m.begin() != m.end()) {
+				Structs1[depGraph->findNode(i->second)] = m;
+				NumVulArrays++;
+				NumVulArraysSt++;
+			}
+		}
+		for (std::vector<Value*>::iterator i = scan.structCasts.begin(), e =
+				scan.structCasts.end(); i != e; ++i) {
+			DenseMap<const Value*, std::vector<GraphNode*> > m = findDeps(*i,
+					inputDepValues);
+			if (m.begin() != m.end())
+				Structs2[depGraph->findNode(*i)] = m;
+		}
+
 		bool dep = false;
-		if (arrays.size() > 1) {
-			for (std::set<Value*>::iterator i = arrays.begin(), e =
-					arrays.end(); i != e; ++i) {
+		if (scan.arrays.size() > 1) {
+			for (std::set<Value*>::iterator i = scan.arrays.begin(), e =
+					scan.arrays.end(); i != e; ++i) {
 				DenseMap<const Value*, std::vector<GraphNode*> > m =
-						getValueDeps(*i, inputDepValues);
+						findDeps(*i, inputDepValues);
 				if (m.begin() != m.end()) {
 					dep = true;
 					Arrays[depGraph->findNode(*i)] = m;
@@ -250,9 +447,8 @@ bool VulArrays::runOnModule(Module &M) {
 			}
 		}
 		if (dep) {
-			NumVulArrays += arrays.size() - 1;
-			NumVulArraysAr += arrays.size() - 1;
-			;
+			NumVulArrays += scan.arrays.size() - 1;
+			NumVulArraysAr += scan.arrays.size() - 1;
 		}
 	}
 	toDot(M.getModuleIdentifier());
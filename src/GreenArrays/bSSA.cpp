@@ -4,8 +4,12 @@
 
 using namespace llvm;
 
-std::set<BasicBlock *> GatedBB;
-std::vector<BasicBlock *> ProcessedBB;
+static cl::opt<bool> controlRegionNodes("controlRegionNodes",
+		cl::desc("Link each predicate to one node per fully gated basic block instead of to each gated instruction."),
+		cl::init(false));
+
+//Blocks ending in a conditional branch that a predicate of the current function has gated
+SmallPtrSet<BasicBlock *, 32> GatedBB;
 
 //Receive a predicate and include it on predicate attribute
 Pred::Pred(Value *p) {
@@ -15,6 +19,7 @@ Pred::Pred(Value *p) {
 //Receive a instruction and include it on insts vector
 void Pred::addInst(Instruction *i) {
 	insts.push_back(i);
+	gated.insert(i);
 }
 
 //Receive a function pointer and include it on funcs vector
@@ -53,21 +58,14 @@ Function *Pred::getFunc(int i) {
 
 //Return true of *op instruction is gated (if it is stored on insts vector) for the predicate
 bool Pred::isGated(Instruction *op) {
-	unsigned int i;
-
-	for (i = 0; i < insts.size(); i++) {
-		if (op == insts[i])
-			return true;
-	}
-
-	return false;
+	return gated.count(op);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //Passes which are used by bSSA pass
 void bSSA::getAnalysisUsage(AnalysisUsage &AU) const {
 
-	AU.addRequired<PostDominatorTree> ();
+	AU.addRequired<ControlDependence> ();
 	AU.addRequired<DominatorTree>();
 	AU.addRequired<moduleDepGraph> ();
 
@@ -111,11 +109,12 @@ bool bSSA::runOnModule(Module &M) {
 		// Iterate over all Basic Blocks of the Function
 		if (F->begin() != F->end()) {
 			DominatorTree &DT = getAnalysis<DominatorTree> (*F);
-			PostDominatorTree &PD = getAnalysis<PostDominatorTree> (*F);
+			//Control dependences of F, computed once for all its predicates
+			ControlDependence &CD = getAnalysis<ControlDependence> (*F);
 			GatedBB.clear();
 			for (po_iterator<DomTreeNode*> Fit = po_begin(DT.getRootNode()),
 					Fend = po_end(DT.getRootNode()); Fit != Fend; Fit++) {
-				makeTable(Fit->getBlock(), PD); //Creating in memory the table with predicates and gated instructions
+				makeTable(Fit->getBlock(), CD); //Creating in memory the table with predicates and gated instructions
 			}
 		}
 	}
@@ -127,107 +126,101 @@ bool bSSA::runOnModule(Module &M) {
 }
 
 //Increase graph including control edges
-void bSSA::incGraph(Graph *g) {
+void bSSA::incGraph (Graph *g) {
 	unsigned int i;
-	int j;
+	int j, k;
 
 	//For all predicates in predicatesVector
-	for (i = 0; i < predicatesVector.size(); i++) {
+	for (i=0; i<predicatesVector.size(); i++) {
 		//Locates the predicate (icmp instrution) Localiza o predicado (instrução icmp) from the graph
 		GraphNode *predNode = g->findNode(predicatesVector[i]->getPred());
+		if (predNode == NULL)
+			continue;
 
 		//For each predicate, iterates on the list of gated INSTRUCTIONS
-		for (j = 0; j < predicatesVector[i]->getNumInstrucoes(); j++) {
-			GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(j));
-			if (predNode != NULL && instNode != NULL) {//If the instruction is on the graph, make a edge
-				g->addEdge(predNode, instNode, etControl);
+		for (j=0; j<predicatesVector[i]->getNumInstrucoes(); j = k) {
+			Instruction *inst = predicatesVector[i]->getInst(j);
+			BasicBlock *BB = inst->getParent();
+
+			//Gated instructions come a block at a time; k ends the run of BB
+			for (k = j + 1; k < predicatesVector[i]->getNumInstrucoes() && predicatesVector[i]->getInst(k)->getParent() == BB; k++)
+				;
+
+			//The whole block is gated: one edge to its region node
+			if (controlRegionNodes && inst == &BB->front() && (size_t)(k - j) == BB->size()) {
+				g->addEdge(predNode, getRegionNode(g, BB), etControl);
+				continue;
+			}
+
+			for (int l = j; l < k; l++) {
+				GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(l));
+				if (instNode != NULL) //If the instruction is on the graph, make a edge
+					g->addEdge(predNode, instNode, etControl);
 			}
 		}
 
-		//For each predicate, iterates on the list of gated FUNCTIONS
-		for (j = 0; j < predicatesVector[i]->getNumFunctions(); j++) {
+		//For each predicate, iterates on the list of gated FUNCTIONS: one edge to the entry gate of each
+		for (j=0; j<predicatesVector[i]->getNumFunctions(); j++) {
 			Function *F = predicatesVector[i]->getFunc(j);
-			//For each function, iterates on its basic blocks
-			for (Function::iterator Fit = F->begin(), Fend = F->end(); Fit
-					!= Fend; ++Fit) {
-				//For each basic block, iterates on its instructions
-				for (BasicBlock::iterator bBIt = Fit->begin(), bBEnd =
-						Fit->end(); bBIt != bBEnd; ++bBIt) {
-					GraphNode *instNode = g->findNode(bBIt);
-					if (predNode != NULL && instNode != NULL)
-						g->addEdge(predNode, instNode, etControl);
-				}
-			}
+			g->addEdge(predNode, g->addJoin(F), etControl);
 		}
 
 	}
 
 }
 
+//Returns the node that stands for every instruction of BB in the control edges, creating it on first use
+GraphNode *bSSA::getRegionNode (Graph *g, BasicBlock *BB) {
+	DenseMap<BasicBlock *, GraphNode *>::iterator it = regionNodes.find(BB);
+	if (it != regionNodes.end())
+		return it->second;
+
+	GraphNode *regionNode = new OpNode(Instruction::Br);
+	regionNodes[BB] = regionNode;
+	for (BasicBlock::iterator bBIt = BB->begin(), bBEnd = BB->end(); bBIt != bBEnd; ++bBIt) {
+		GraphNode *instNode = g->findNode(bBIt);
+		if (instNode != NULL)
+			g->addEdge(regionNode, instNode, etControl);
+	}
+	return regionNode;
+}
+
 //It receives a BasicBLock and makes table of predicates and its respective gated instructions
-void bSSA::makeTable(BasicBlock *BB, PostDominatorTree &PD) {
+void bSSA::makeTable(BasicBlock *BB, ControlDependence &CD) {
 	Value *condition;
 	TerminatorInst *ti = BB->getTerminator();
 	BranchInst *bi = NULL;
 	SwitchInst *si = NULL;
 
-	//        PostDominatorTree &PD = getAnalysis<PostDominatorTree>(*F);
-
-	ProcessedBB.clear();
 	if ((bi = dyn_cast<BranchInst> (ti)) && bi->isConditional()) { //If the terminator instruction is a conditional branch
 		condition = bi->getCondition();
 		//Including the predicate on the predicatesVector
 		predicatesVector.push_back(new Pred(condition));
-		//Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-		for (unsigned int i = 0; i < bi->getNumSuccessors(); i++) {
-			findIR(BB, bi->getSuccessor(i), PD);
-		}
+		//Gate the instructions on Influence Region of the predicate
+		gateRegion(BB, CD);
 	} else if ((si = dyn_cast<SwitchInst> (ti))) {
 		condition = si->getCondition();
 		//Including the predicate on the predicatesVector
 		predicatesVector.push_back(new Pred(condition));
-		//Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-		for (unsigned int i = 0; i < si->getNumSuccessors(); i++) {
-			findIR(BB, si->getSuccessor(i), PD);
-		}
+		//Gate the instructions on Influence Region of the predicate
+		gateRegion(BB, CD);
 	}
 }
 
-//Flooding until reach a posdominator node
-void bSSA::findIR(BasicBlock *bBOring, BasicBlock *bBSuss,
-		PostDominatorTree &PD) {
+//Gates the influence region of the branch that ends BB with the last predicate
+void bSSA::gateRegion(BasicBlock *BB, ControlDependence &CD) {
 
-	Pred *p;
-	TerminatorInst *ti = bBSuss->getTerminator();
+	Pred *p = predicatesVector.back();
+	std::vector<BasicBlock *> region, exits;
 
-	//If the basic block has been processed, do not advance
-	for (unsigned int x = 0; x < ProcessedBB.size(); x++) {
-		if (ProcessedBB[x] == bBSuss) {
-			return;
-		}
-	}
+	//Do not go past a conditional branch whose IR has been processed
+	CD.getInfluenceRegion(BB, region, exits, &GatedBB);
 
-	//Including the basic block in the processed vector
-	ProcessedBB.push_back(bBSuss);
-
-	//If the basic block is a posdominator and is not the start basic block, just gate the PHI instructions
-	if (PD.dominates(bBSuss, bBOring) && bBSuss != bBOring) {
-		//Find PHI instructions
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end(); bBIt
+	//Instruction will be gated whit the BB predicate
+	for (std::vector<BasicBlock *>::iterator it = region.begin(), e =
+			region.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end(); bBIt
 				!= bBEnd; ++bBIt) {
-			if (dyn_cast<Instruction> (bBIt)->getOpcode() == Instruction::PHI) {
-				//gate the PHI instruction
-				p = predicatesVector.back();
-				p->addInst(bBIt);
-			}
-		}
-		return;
-	} else { //Advance the flooding
-		//Instruction will be gated whit the bBOring predicate
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end(); bBIt
-				!= bBEnd; ++bBIt) {
-			p = predicatesVector.back();
-
 			//If is a function call which is defined on the same module
 			if (CallInst *CI = dyn_cast<CallInst>(&(*bBIt))) {
 				Function *F = CI->getCalledFunction();
@@ -240,22 +233,26 @@ void bSSA::findIR(BasicBlock *bBOring, BasicBlock *bBSuss,
 			//Gate the other instructions
 			p->addInst(bBIt);
 		}
+	}
 
-		//If is a basic block which its IR has been processed and it has a conditional instruction, do not advance
-		if (GatedBB.count(bBSuss) > 0) {
-			TerminatorInst *ti = bBSuss->getTerminator();
-			BranchInst *bi;
-			if ((bi = dyn_cast<BranchInst> (ti)) && bi->isConditional())
-				return;
-		}
-		GatedBB.insert(bBSuss);
-
-		//If there is successor, go there
-		for (unsigned int i = 0; i < ti->getNumSuccessors(); i++) {
-			findIR(bBOring, ti->getSuccessor(i), PD);
+	//The exits post-dominate BB: just gate the PHI instructions
+	for (std::vector<BasicBlock *>::iterator it = exits.begin(), e =
+			exits.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end(); bBIt
+				!= bBEnd; ++bBIt) {
+			if (dyn_cast<Instruction> (bBIt)->getOpcode() == Instruction::PHI) {
+				//gate the PHI instruction
+				p->addInst(bBIt);
+			}
 		}
 	}
 
+	for (std::vector<BasicBlock *>::iterator it = region.begin(), e =
+			region.end(); it != e; ++it) {
+		BranchInst *bi;
+		if ((bi = dyn_cast<BranchInst> ((*it)->getTerminator())) && bi->isConditional())
+			GatedBB.insert(*it);
+	}
 }
 
 //All instrutions of function F are gated with predicate p
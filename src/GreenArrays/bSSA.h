@@ -19,6 +19,7 @@
 #include <vector>
 #include <string>
 #include "DepGraph.h"
+#include "ControlDependence.h"
 #include <sstream>
 
 #ifndef DEBUG_TYPE
@@ -32,6 +33,7 @@ namespace llvm {
 	class Pred {
 		Value *predicate;
 		std::vector<Instruction *> insts;
+		SmallPtrSet<Instruction *, 32> gated;	//Same instructions as insts, for isGated
 		std::vector<Function *> funcs;
 
 	public:
@@ -66,9 +68,11 @@ namespace llvm {
 
 	private:
         	std::vector<Pred *> predicatesVector;	//Vector of predicates objects
-        	void makeTable (BasicBlock *b, PostDominatorTree& PD);
-        	void findIR (BasicBlock *borigin, BasicBlock *bdst, PostDominatorTree &PD);	//Run on Influence Region of basic block borigin gated all instructions
+        	void makeTable (BasicBlock *b, ControlDependence &CD);
+        	void gateRegion (BasicBlock *BB, ControlDependence &CD);	//Gate all instructions on the Influence Region of the branch that ends BB
         	void gateFunction (Function *F, Pred *p);
+        	DenseMap<BasicBlock *, GraphNode *> regionNodes;	//Control region node of each basic block
+        	GraphNode *getRegionNode (Graph *g, BasicBlock *BB);
  	};
 
 
@@ -156,6 +156,8 @@ bool ::OverflowSanitizer::runOnModule(Module& M) {
 	insertGlobalDeclarations();
 
 	std::set<Value*> memAllocs;
+	SourceSinks &catalog = SourceSinks::get();
+	catalog.cacheFunctions(M);
 	Graph* graph = depGraph.depGraph;
 
 	for (Module::iterator F = M.begin(), endF = M.end(); F != endF; ++F) {
@@ -163,13 +165,8 @@ bool ::OverflowSanitizer::runOnModule(Module& M) {
 			for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I
 					!= endI; ++I) {
 				CallInst *CI = dyn_cast<CallInst> (I);
-				if (CI) {
-					Function *FF = CI->getCalledFunction();
-					if (FF && (FF->getName() == "malloc" || FF->getName()
-							== "realloc" || FF->getName() == "calloc"
-							|| FF->getName() == "xalloc")) {
-						memAllocs.insert(CI);
-					}
+				if (CI && catalog.is(CI, crAlloc)) {
+					memAllocs.insert(CI);
 				}
 			}
 		}
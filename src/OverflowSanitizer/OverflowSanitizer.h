@@ -38,6 +38,7 @@
 
 #include "../../Analysis/DepGraph/InputValues.h"
 #include "../../Analysis/DepGraph/DepGraph.h"
+#include "../../Analysis/DepGraph/SourceSinks.h"
 #include "../uSSA/uSSA.h"
 
 using namespace llvm;
@@ -12,6 +12,10 @@ static cl::opt<llvm::cl::boolOrDefault>
 						"Specify if every value from libraries should be treated as tainted. Default is true."),
 				cl::value_desc("Input description"));
 
+static cl::opt<bool> tfaDemand("tfaDemand",
+		cl::desc("Compute taint only for the values that are queried, searching backwards from them."),
+		cl::init(false));
+
 TFA::TFA() :
 	ModulePass(ID) {
 
@@ -37,35 +41,191 @@ bool TFA::runOnModule(Module &M) {
 	depGraph->toDot(M.getModuleIdentifier(), Filename);
 	DisplayGraph(Filename, true, GraphProgram::DOT);
 	);
-	tainted = depGraph->getDepValues(inputDepValues);
-	NumTaintedNodes = tainted.size();
+	tainted.clear();
+	clean.clear();
+	sources.clear();
+	sourceValues.clear();
+	growBitVectors();
+	for (std::set<Value*>::iterator V = inputDepValues.begin(), E =
+			inputDepValues.end(); V != E; ++V) {
+		if (GraphNode* n = depGraph->findNode(*V)) {
+			sources.set(n->getId());
+			sourceValues[n].push_back(*V);
+		}
+	}
+	//In demand mode queries search backwards from the sinks; nothing is computed up front
+	if (!tfaDemand) {
+		depGraph->getDepValues(inputDepValues, tainted);
+		tainted.resize(sources.size());
+		//No input reaches the other nodes, so searches from sinks can skip them
+		clean = tainted;
+		clean |= sources;
+		clean.flip();
+	}
+	NumTaintedNodes = tainted.count();
 	NumNodes = depGraph->getNodes().size();
 
 	DEBUG( // If debug mode is enabled, add metadata to easily identify tainted values in the llvm IR
+	annotateTainted(M);
+	);
+	return false;
+}
+
+void TFA::annotateTainted(Module &M) {
+	LLVMContext& C = M.getContext();
+	MDNode* N = MDNode::get(C, MDString::get(C, "TFA"));
 	for (Module::iterator F = M.begin(), endF = M.end(); F != endF; ++F) {
 		for (Function::iterator BB = F->begin(), endBB = F->end(); BB != endBB; ++BB) {
 			for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I
 					!= endI; ++I) {
-				GraphNode* g = depGraph->findNode(I);
-				if (tainted.count(g)) {
-					LLVMContext& C = I->getContext();
-					MDNode* N = MDNode::get(C, MDString::get(C, "TFA"));
+				if (isNodeTainted(depGraph->findNode(I)))
 					I->setMetadata("tainted", N);
+			}
+		}
+	}
+}
+
+const BitVector& TFA::getTaintedNodes() const {
+	return tainted;
+}
+
+bool TFA::isNodeTainted(GraphNode* n) {
+	if (!n)
+		return false;
+	if (tfaDemand) {
+		growBitVectors();
+		if (tainted.test(n->getId()))
+			return true;
+		if (clean.test(n->getId()))
+			return false;
+		return searchBackwards(n, true, NULL);
+	}
+	//Nodes created after the analysis ran are not tainted
+	return (unsigned) n->getId() < tainted.size() && tainted.test(n->getId());
+}
+
+//Nodes may have been added to the graph since the last query
+void TFA::growBitVectors() {
+	unsigned numIds = GraphNode::getNumIds();
+	if (tainted.size() < numIds) {
+		tainted.resize(numIds);
+		clean.resize(numIds);
+		sources.resize(numIds);
+	}
+}
+
+/*
+ * Demand mode: n is tainted if an input node reaches it through at least one
+ * edge, as in the forward search. The search walks predecessors and, when
+ * stopAtSource is set, stops at the first input node or known tainted node;
+ * the nodes on that path are then known tainted. A search that finds no input
+ * proves every node it visited clean, so later queries skip them. Input
+ * nodes are never marked clean: an input is not tainted by itself, but the
+ * nodes it reaches are. Otherwise the input values found are added to inputs.
+ */
+bool TFA::searchBackwards(GraphNode* n, bool stopAtSource,
+		std::set<Value*>* inputs) {
+	std::vector<GraphNode*> visited;
+	DenseMap<GraphNode*, GraphNode*> parent; //the successor through which a node was reached
+	std::deque<GraphNode*> worklist;
+	GraphNode* found = NULL;
+	bool reached = false;
+
+	worklist.push_back(n);
+	while (!worklist.empty() && !found) {
+		GraphNode* u = worklist.front();
+		worklist.pop_front();
+		std::map<GraphNode*, edgeType> preds = u->getPredecessors();
+		for (std::map<GraphNode*, edgeType>::iterator i = preds.begin(), e =
+				preds.end(); i != e; ++i) {
+			GraphNode* v = i->first;
+			unsigned id = v->getId();
+			if (parent.count(v))
+				continue;
+			bool hit = sources.test(id) || tainted.test(id);
+			if (!hit && clean.test(id))
+				continue;
+			visited.push_back(v);
+			parent[v] = u;
+			if (hit) {
+				reached = true;
+				if (inputs && sources.test(id)) {
+					std::vector<Value*> &values = sourceValues[v];
+					inputs->insert(values.begin(), values.end());
+				}
+				if (stopAtSource) {
+					found = v;
+					break;
 				}
 			}
+			worklist.push_back(v);
 		}
 	}
-	);
-	return false;
+
+	if (!reached) {
+		if (!sources.test(n->getId()))
+			clean.set(n->getId());
+		for (std::vector<GraphNode*>::iterator v = visited.begin(), e =
+				visited.end(); v != e; ++v)
+			clean.set((*v)->getId()); //Not inputs, or reached would be set
+		return false;
+	}
+
+	tainted.set(n->getId());
+	for (GraphNode* v = found ? parent[found] : NULL; v && v != n; v = parent[v])
+		tainted.set(v->getId()); //Every node after the input on the path
+	return true;
+}
+
+std::set<Value*> TFA::getInputsReaching(Value* sink) {
+	std::set<Value*> inputs;
+	GraphNode* n = depGraph->findNode(sink);
+	if (!n)
+		return inputs;
+	growBitVectors();
+	if (!clean.test(n->getId()))
+		searchBackwards(n, false, &inputs);
+	return inputs;
 }
 
 bool TFA::isValueTainted(Value* v) {
-	GraphNode* g = depGraph->findNode(v);
-	return tainted.count(g);
+	return isNodeTainted(depGraph->findNode(v));
+}
+
+void TFA::getTaintedValues(const std::vector<Value*> &values, BitVector &result) {
+	result.clear();
+	result.resize(values.size());
+	for (unsigned i = 0; i < values.size(); i++) {
+		if (isValueTainted(values[i]))
+			result.set(i);
+	}
+}
+
+//Lists the tainted instructions in the order of the module; in demand mode
+//this queries each input before the values it reaches
+void TFA::print(raw_ostream &O, const Module *M) const {
+	TFA *self = const_cast<TFA*>(this); //Demand mode answers by filling the bit vectors
+	for (Module::const_iterator F = M->begin(), endF = M->end(); F != endF; ++F) {
+		for (Function::const_iterator BB = F->begin(), endBB = F->end(); BB
+				!= endBB; ++BB) {
+			for (BasicBlock::const_iterator I = BB->begin(), endI = BB->end(); I
+					!= endI; ++I) {
+				if (I->hasName() && self->isValueTainted(const_cast<Instruction*>(&*I)))
+					O << F->getName() << ": " << I->getName() << "\n";
+			}
+		}
+	}
 }
 
 std::set<GraphNode*> TFA::getTaintedValues() {
-	return tainted;
+	std::set<GraphNode*> result;
+	std::set<GraphNode*> nodes = depGraph->getNodes();
+	for (std::set<GraphNode*>::iterator n = nodes.begin(), e = nodes.end(); n
+			!= e; ++n) {
+		if (isNodeTainted(*n))
+			result.insert(*n);
+	}
+	return result;
 }
 
 void TFA::getAnalysisUsage(AnalysisUsage &AU) const {
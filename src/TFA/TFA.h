@@ -36,12 +36,26 @@ class TFA : public ModulePass {
 		std::set<Value*> inputDepValues;
 		bool runOnModule(Module &M);
 		bool isValueInpDep(Value* V);
-		std::set<GraphNode*> tainted;
+		BitVector tainted; //indexed by node ID
+		//Demand mode: nodes known to be clean, and the nodes of the inputs
+		BitVector clean;
+		BitVector sources;
+		DenseMap<GraphNode*, std::vector<Value*> > sourceValues;
+		void growBitVectors();
+		bool searchBackwards(GraphNode* n, bool stopAtSource,
+				std::set<Value*>* inputs);
 	public:
 		static char ID;
 		void getAnalysisUsage(AnalysisUsage &AU) const;
 		std::set<GraphNode*> getTaintedValues();
+		const BitVector& getTaintedNodes() const; //The result without copies (demand mode: the nodes found so far)
+		bool isNodeTainted(GraphNode* n);
 		bool isValueTainted(Value* v);
+		//result[i] tells whether values[i] is tainted
+		void getTaintedValues(const std::vector<Value*> &values, BitVector &result);
+		void annotateTainted(Module &M); //Adds "tainted" metadata to every tainted instruction
+		std::set<Value*> getInputsReaching(Value* sink); //The input values that flow into sink
+		void print(raw_ostream &O, const Module *M) const; //The tainted instructions, one per line
 		TFA();
 
 };
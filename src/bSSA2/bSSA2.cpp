@@ -72,6 +72,7 @@ bool Pred::isFGated(Function *f) {
 void bSSA2::getAnalysisUsage(AnalysisUsage &AU) const {
 
 	AU.addRequired<PostDominatorTree>();
+	AU.addRequired<ControlDependence>();
 	AU.addRequired<DominatorTree>();
 	AU.addRequired<moduleDepGraph>();
 	AU.addRequired<hammock>();
@@ -93,7 +94,7 @@ std::set<Value *> bSSA2::getLeakedValues() {
 
 		if ((*gS)->tainted) {
 			if ((op = dyn_cast<OpNode>((*gS)))) {
-				if (op->tainted)
+				if (op->tainted && op->getValue() != NULL) //region nodes have no value
 					s.insert(op->getValue());
 			} else if ((va = dyn_cast<VarNode>((*gS)))) {
 				if (va->tainted)
@@ -176,10 +177,11 @@ bool bSSA2::runOnModule(Module &M) {
 			} else {
 				// Iterate over all Basic Blocks of the Function
 				if (F->begin() != F->end()) {
-					PostDominatorTree &PD = getAnalysis<PostDominatorTree>(*F);
+					//Control dependences of F, computed once for all its predicates
+					ControlDependence &CD = getAnalysis<ControlDependence>(*F);
 					for (Function::iterator Fit = F->begin(), Fend = F->end();
 							Fit != Fend; ++Fit) {
-						makeTable(Fit, PD); //Creating in memory the table with predicates and gated instructions
+						makeTable(Fit, CD); //Creating in memory the table with predicates and gated instructions
 					}
 				}
 
@@ -415,7 +417,7 @@ void bSSA2::gateChildren(BasicBlock *father, BasicBlock *child, Pred *p,
 //Increase graph including control edges
 void bSSA2::incGraph(Graph *g) {
 	unsigned int i;
-	int j;
+	int j, k;
 
 	//For all predicates in predicatesVector
 	for (i = 0; i < predicatesVector.size(); i++) {
@@ -423,10 +425,29 @@ void bSSA2::incGraph(Graph *g) {
 		GraphNode *predNode = g->findNode(predicatesVector[i]->getPred());
 
 		//For each predicate, iterates on the list of gated INSTRUCTIONS
-		for (j = 0; j < predicatesVector[i]->getNumInstrucoes(); j++) {
-			GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(j));
-			if (predNode != NULL && instNode != NULL) {	//If the instruction is on the graph, make a edge
-				g->addEdge(predNode, instNode, etControl);
+		for (j = 0; j < predicatesVector[i]->getNumInstrucoes(); j = k) {
+			Instruction *inst = predicatesVector[i]->getInst(j);
+			BasicBlock *BB = inst->getParent();
+
+			//Gated instructions come a block at a time; k ends the run of BB
+			for (k = j + 1;
+					k < predicatesVector[i]->getNumInstrucoes()
+							&& predicatesVector[i]->getInst(k)->getParent() == BB;
+					k++)
+				;
+
+			//The whole block is gated: one edge to its region node
+			if (controlRegionNodes && predNode != NULL && inst == &BB->front()
+					&& (size_t) (k - j) == BB->size()) {
+				g->addEdge(predNode, getRegionNode(g, BB), etControl);
+				continue;
+			}
+
+			for (int l = j; l < k; l++) {
+				GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(l));
+				if (predNode != NULL && instNode != NULL) {	//If the instruction is on the graph, make a edge
+					g->addEdge(predNode, instNode, etControl);
+				}
 			}
 		}
 
@@ -457,77 +478,62 @@ void bSSA2::incGraph(Graph *g) {
 
 }
 
+//Returns the node that stands for every instruction of BB in the control edges, creating it on first use
+GraphNode *bSSA2::getRegionNode(Graph *g, BasicBlock *BB) {
+	DenseMap<BasicBlock *, GraphNode *>::iterator it = regionNodes.find(BB);
+	if (it != regionNodes.end())
+		return it->second;
+
+	GraphNode *regionNode = new OpNode(Instruction::Br);
+	regionNodes[BB] = regionNode;
+	for (BasicBlock::iterator bBIt = BB->begin(), bBEnd = BB->end();
+			bBIt != bBEnd; ++bBIt) {
+		GraphNode *instNode = g->findNode(bBIt);
+		if (instNode != NULL)
+			g->addEdge(regionNode, instNode, etControl);
+	}
+	return regionNode;
+}
+
 //It receives a BasicBLock and makes table of predicates and its respective gated instructions
-void bSSA2::makeTable(BasicBlock *BB, PostDominatorTree &PD) {
+void bSSA2::makeTable(BasicBlock *BB, ControlDependence &CD) {
 	Value *condition;
 	TerminatorInst *ti = BB->getTerminator();
 	BranchInst *bi = NULL;
 	SwitchInst *si = NULL;
 	Pred *predicate;
 
-	ProcessedBB.clear();
 	if ((bi = dyn_cast<BranchInst>(ti)) && bi->isConditional()) { //If the terminator instruction is a conditional branch
 		condition = bi->getCondition();
 		//Including the predicate on the predicatesVector
 		predicate = new Pred(condition);
 		predicatesVector.push_back(predicate);
-		//Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-		for (unsigned int i = 0; i < bi->getNumSuccessors(); i++) {
-			findIR(BB, bi->getSuccessor(i), PD, predicate);
-		}
+		//Gate the instructions on Influence Region of the predicate
+		gateRegion(BB, CD, predicate);
 	} else if ((si = dyn_cast<SwitchInst>(ti))) {
 		condition = si->getCondition();
 		//Including the predicate on the predicatesVector
 		predicate = new Pred(condition);
 		predicatesVector.push_back(predicate);
-		//Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-		for (unsigned int i = 0; i < si->getNumSuccessors(); i++) {
-			findIR(BB, si->getSuccessor(i), PD, predicate);
-		}
+		//Gate the instructions on Influence Region of the predicate
+		gateRegion(BB, CD, predicate);
 	}
 }
 
-//Flooding until reach a posdominator node
-void bSSA2::findIR(BasicBlock *bBOring, BasicBlock *bBSuss,
-		PostDominatorTree &PD, Pred *p) {
-	BasicBlock *temp;
-	TerminatorInst *ti = bBSuss->getTerminator();
+//Gates the influence region of the branch that ends BB with predicate p
+void bSSA2::gateRegion(BasicBlock *BB, ControlDependence &CD, Pred *p) {
+	std::vector<BasicBlock *> region, exits;
 
 	//Existe caso onde uma instrução de comparação é na verdade uma constante e neste caso ela não está ligada à nenhum BasicBlock. Fica como toDO
-	if (dyn_cast<Instruction>(p->getPred()) != NULL)
-		temp = dyn_cast<Instruction>(p->getPred())->getParent();
-	else
+	if (dyn_cast<Instruction>(p->getPred()) == NULL)
 		return;
 
-	//If the basic block has been processed, do not advance
-	for (unsigned int x = 0; x < ProcessedBB.size(); x++) {
-		if (ProcessedBB[x] == bBSuss) {
-			return;
-		}
-	}
+	CD.getInfluenceRegion(BB, region, exits);
 
-	//Including the basic block in the processed vector
-	ProcessedBB.push_back(bBSuss);
-
-	//If the basic block is a post dominator and is not the start basic block, just return
-	if (PD.dominates(bBSuss, bBOring) && bBSuss != bBOring) {
-		//Find PHI instructions
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end();
-				bBIt != bBEnd; ++bBIt) {
-			if (dyn_cast<Instruction>(bBIt)->getOpcode() == Instruction::PHI) {
-				//if there is a PHI's argument gated, gate the PHI instruction
-				//for (unsigned int k=0; k<dyn_cast<Instruction>(bBIt)->getNumOperands(); k++) {
-				//if (p->isGated(dyn_cast<Instruction>(dyn_cast<Instruction>(bBIt)->getOperand(k)))) {
-				p->addInst(bBIt);
-				//break;
-				//}
-				//}
-			}
-		}
-		return;
-	} else { //Advance the flooding
-		//Instruction will be gated whit the bBOring predicate
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end();
+	//Instruction will be gated whit the BB predicate
+	for (std::vector<BasicBlock *>::iterator it = region.begin(), e =
+			region.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end();
 				bBIt != bBEnd; ++bBIt) {
 
 			//If is a function call which is defined on the same module
@@ -544,9 +550,16 @@ void bSSA2::findIR(BasicBlock *bBOring, BasicBlock *bBSuss,
 			//Gate the other instructions
 			p->addInst(bBIt);
 		}
-		//If there is successor, go there
-		for (unsigned int i = 0; i < ti->getNumSuccessors(); i++) {
-			findIR(bBOring, ti->getSuccessor(i), PD, p);
+	}
+
+	//The exits post-dominate BB: just gate the PHI instructions
+	for (std::vector<BasicBlock *>::iterator it = exits.begin(), e =
+			exits.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end();
+				bBIt != bBEnd; ++bBIt) {
+			if (dyn_cast<Instruction>(bBIt)->getOpcode() == Instruction::PHI) {
+				p->addInst(bBIt);
+			}
 		}
 	}
 
@@ -28,10 +28,9 @@
 #include "llvm/Constant.h"
 #include "llvm/Constants.h"
 #include "../hammock/hammock.h"
+#include "../DepGraph/ControlDependence.h"
 #include <stack>
 
-// Global variables
-std::vector<BasicBlock *> ProcessedBB; //Stores processed basic block used in makeTable and findIR methods
 
 
 
@@ -40,6 +39,7 @@ namespace llvm {
 
 	// opt -o parameter in order to force the optimization (new style of control dependence graph construction)
 	cl::opt<bool> IsOptimized("o", cl::desc("Specify whether to use optimized version (getting transitivity on control edges"), cl::desc("is optmized"));
+	cl::opt<bool> controlRegionNodes("controlRegionNodes", cl::desc("Link each predicate to one node per fully gated basic block instead of to each gated instruction."), cl::init(false));
 
 	STATISTIC(numSources, "Number of secret information sources");
 	STATISTIC(numSink, "Number of public channels (printf etc.)");
@@ -154,6 +154,16 @@ namespace llvm {
 				// \param g The dependence graph
 				void incGraph (Graph *g);
 
+				// Control region node of each basic block
+				DenseMap<BasicBlock *, GraphNode *> regionNodes;
+
+				// \brief Return the node that stands for every instruction of BB in the control edges
+				//
+				// \param g The dependence graph
+				// \param BB The basic block
+				// \return The region node, created on first use
+				GraphNode *getRegionNode (Graph *g, BasicBlock *BB);
+
 				// Complete depGraph including data and control edges
 				Graph *newGraph;
 
@@ -174,16 +184,15 @@ namespace llvm {
 
 				// \brief It receives a BasicBLock and makes table of predicates and its respective gated instructions
 				// \param b the initial BasicBlock
-				// \param PD PostDominator Tree
-				void makeTable (BasicBlock *b,  PostDominatorTree& PD );
+				// \param CD Control dependences of the function
+				void makeTable (BasicBlock *b, ControlDependence &CD);
 
-				// \brief Flooding until reach a posDominator node and gate all instruction with p predicate
+				// \brief Gate all instructions on the Influence Region of the branch that ends BB with p predicate
 				//
-				// \param borigin Start Basic Block
-				// \param bdst Successor basic block
-				// \para PD PostDominator tree in order to know the imediate post dominator
-				// zpara p Predicate which is used to gate instructions found on IR
-				void findIR (BasicBlock *borigin, BasicBlock *bdst, PostDominatorTree &PD, Pred *p);
+				// \param BB Basic block ended by the branch
+				// \param CD Control dependences of the function
+				// \param p Predicate which is used to gate instructions found on IR
+				void gateRegion (BasicBlock *BB, ControlDependence &CD, Pred *p);
 
 				// \brief All instrutions of function F are gated with predicate p
 				//
@@ -817,6 +817,33 @@ void Graph::addEdge(GraphNode* src, GraphNode* dst, edgeType type) {
 
 }
 
+GraphNode* Graph::addJoin(Function *F) {
+
+        if (GraphNode* join = findJoinNode(F))
+                return join;
+
+        GraphNode* join = new OpNode(Instruction::Call);
+        joinNodes[F] = join;
+        nodes.insert(join);
+
+        for (Function::iterator BB = F->begin(), endBB = F->end(); BB != endBB; ++BB) {
+                for (BasicBlock::iterator I = BB->begin(), endI = BB->end(); I != endI; ++I) {
+                        if (GraphNode* node = findNode(I))
+                                addEdge(join, node, etControl);
+                }
+        }
+
+        return join;
+}
+
+GraphNode* Graph::findJoinNode(Function *F) {
+
+        DenseMap<Function*, GraphNode*>::iterator it = joinNodes.find(F);
+        if (it == joinNodes.end())
+                return NULL;
+        return it->second;
+}
+
 //It verify if the instruction is valid for the dependence graph, i.e. just data manipulator instructions are important for dependence graph
 bool Graph::isValidInst(Value *v) {
 
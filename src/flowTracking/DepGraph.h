@@ -260,6 +260,8 @@ private:
 
         std::set<GraphNode*> nodes;
 
+        llvm::DenseMap<Function*, GraphNode*> joinNodes; //Entry gate of each gated function
+
         AliasSets *AS;
 
         bool isValidInst(Value *v); //Return true if the instruction is valid for dependence graph construction
@@ -287,6 +289,9 @@ public:
 
         void addEdge(GraphNode* src, GraphNode* dst, edgeType type = etData);
 
+        GraphNode* addJoin(Function *F); //Return the entry gate of F (control edges to every node of F), creating it on first use
+        GraphNode* findJoinNode(Function *F); //Return the entry gate of F or NULL if it has none
+
         GraphNode* findNode(Value *op); //Return the pointer to the node or NULL if it is not in the graph
         std::set<GraphNode*> findNodes(std::set<Value*> values);
 
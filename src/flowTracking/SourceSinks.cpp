@@ -0,0 +1,211 @@
+#include "SourceSinks.h"
+
+static cl::opt<std::string> sourceSinkSpec("sourceSinkSpec",
+		cl::desc("File with extra input sources, copies, output sinks and allocators."),
+		cl::init(""));
+
+//The functions known before the catalog existed
+static const char* defaultSpec =
+		"# Input sources\n"
+		"main input 1\n"
+		"scanf input 1...\n"
+		"__isoc99_scanf input 1...\n"
+		"fscanf input 2...\n"
+		"__isoc99_fscanf input 2...\n"
+		"gets input 0\n"
+		"fgets input 0\n"
+		"fread input 0\n"
+		"getwd input 0\n"
+		"getcwd input 0\n"
+		"fgetc input ret\n"
+		"getc input ret\n"
+		"getchar input ret\n"
+		"recv input 1\n"
+		"recvmsg input 1\n"
+		"read input 1\n"
+		"recvfrom input 1 4\n"
+		"# Copies: source arguments, then destination argument\n"
+		"memcpy copy 1 0\n"
+		"memmove copy 1 0\n"
+		"memset copy 1 0\n"
+		"strcpy copy 1 0\n"
+		"strncpy copy 1 0\n"
+		"strcat copy 1 0\n"
+		"strncat copy 1 0\n"
+		"sprintf copy 2... 0\n"
+		"# Output sinks\n"
+		"printf output\n"
+		"fiprintf output\n"
+		"fprintf output\n"
+		"iprintf output\n"
+		"vfprintf output\n"
+		"vprintf output\n"
+		"fputc output\n"
+		"fputs output\n"
+		"putc output\n"
+		"putchar output\n"
+		"puts output\n"
+		"fwrite output\n"
+		"pwrite output\n"
+		"write output\n"
+		"# Allocators\n"
+		"malloc alloc\n"
+		"calloc alloc\n"
+		"realloc alloc\n"
+		"realloccf alloc\n"
+		"valloc alloc\n"
+		"xalloc alloc\n"
+		"Znwj alloc\n"
+		"ZnwjRKSt9nothrow_t alloc\n"
+		"Znwm alloc\n"
+		"ZnwmRKSt9nothrow_t alloc\n"
+		"Znaj alloc\n"
+		"ZnajRKSt9nothrow_t alloc\n"
+		"Znam alloc\n"
+		"ZnamRKSt9nothrow_t alloc\n";
+
+void CallRole::getValues(CallInst* CI, std::vector<Value*> &values) const {
+	unsigned numArgs = CI->getNumArgOperands();
+	for (std::vector<unsigned>::const_iterator arg = args.begin(), e =
+			args.end(); arg != e; ++arg) {
+		if (*arg < numArgs)
+			values.push_back(CI->getArgOperand(*arg));
+	}
+	for (unsigned arg = varArgsFrom; arg < numArgs; arg++)
+		values.push_back(CI->getArgOperand(arg));
+	if (ret)
+		values.push_back(CI);
+}
+
+SourceSinks::SourceSinks() {
+	parse(defaultSpec, "<default>");
+
+	if (sourceSinkSpec.empty())
+		return;
+
+	OwningPtr<MemoryBuffer> buffer;
+	if (error_code ec = MemoryBuffer::getFile(sourceSinkSpec, buffer)) {
+		errs() << "[SourceSinks] Could not read " << sourceSinkSpec << ": "
+				<< ec.message() << "\n";
+		return;
+	}
+	parse(buffer->getBuffer(), sourceSinkSpec);
+}
+
+SourceSinks& SourceSinks::get() {
+	static SourceSinks catalog;
+	return catalog;
+}
+
+//Splits a line at blanks
+static void tokenize(StringRef line, SmallVectorImpl<StringRef> &tokens) {
+	while (true) {
+		line = line.substr(line.find_first_not_of(" \t\r"));
+		if (line.empty())
+			return;
+		size_t end = line.find_first_of(" \t\r");
+		tokens.push_back(line.substr(0, end));
+		line = line.substr(end);
+	}
+}
+
+//Parses an argument index: N, N... or ret
+static bool parseArg(StringRef token, CallRole &role) {
+	unsigned index;
+	if (token == "ret") {
+		role.ret = true;
+		return true;
+	}
+	if (token.endswith("...")) {
+		if (token.substr(0, token.size() - 3).getAsInteger(10, index))
+			return false;
+		role.varArgsFrom = index;
+		return true;
+	}
+	if (token.getAsInteger(10, index))
+		return false;
+	role.args.push_back(index);
+	return true;
+}
+
+bool SourceSinks::parse(StringRef spec, StringRef fileName) {
+	bool ok = true;
+	unsigned lineNo = 0;
+
+	while (!spec.empty()) {
+		std::pair<StringRef, StringRef> split = spec.split('\n');
+		StringRef line = split.first;
+		spec = split.second;
+		lineNo++;
+
+		SmallVector<StringRef, 8> tokens;
+		tokenize(line, tokens);
+		if (tokens.empty() || tokens[0].startswith("#"))
+			continue;
+
+		CallRole role;
+		bool valid = tokens.size() >= 2;
+		if (valid && tokens[1] == "input") {
+			role.role = crInput;
+			valid = tokens.size() > 2;
+			for (unsigned i = 2; valid && i < tokens.size(); i++)
+				valid = parseArg(tokens[i], role);
+		} else if (valid && tokens[1] == "copy") {
+			role.role = crCopy;
+			valid = tokens.size() > 3
+					&& !tokens.back().getAsInteger(10, role.dst);
+			for (unsigned i = 2; valid && i + 1 < tokens.size(); i++)
+				valid = parseArg(tokens[i], role) && !role.ret;
+		} else if (valid && tokens[1] == "output") {
+			role.role = crOutput;
+			valid = tokens.size() == 2;
+		} else if (valid && tokens[1] == "alloc") {
+			role.role = crAlloc;
+			valid = tokens.size() == 2;
+		} else
+			valid = false;
+
+		if (!valid) {
+			errs() << "[SourceSinks] " << fileName << ":" << lineNo
+					<< ": malformed entry: " << line << "\n";
+			ok = false;
+			continue;
+		}
+		roles[tokens[0]] = role;
+	}
+
+	return ok;
+}
+
+void SourceSinks::cacheFunctions(Module &M) {
+	//The catalog outlives the module, and a new one may reuse the addresses of the old functions
+	cache.clear();
+	for (Module::iterator F = M.begin(), eM = M.end(); F != eM; ++F)
+		cache[F] = lookup(F->getName());
+}
+
+const CallRole* SourceSinks::lookup(StringRef name) const {
+	StringMap<CallRole>::const_iterator it = roles.find(name);
+	if (it == roles.end())
+		return NULL;
+	return &it->getValue();
+}
+
+const CallRole* SourceSinks::lookup(const Function* F) const {
+	DenseMap<const Function*, const CallRole*>::const_iterator it = cache.find(F);
+	if (it != cache.end())
+		return it->second;
+	return lookup(F->getName());
+}
+
+const CallRole* SourceSinks::lookup(CallInst* CI) const {
+	Function* Callee = CI->getCalledFunction();
+	if (!Callee)
+		return NULL;
+	return lookup(Callee);
+}
+
+bool SourceSinks::is(CallInst* CI, callRole role) const {
+	const CallRole* R = lookup(CI);
+	return R && R->role == role;
+}
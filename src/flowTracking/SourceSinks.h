@@ -0,0 +1,86 @@
+#ifndef __SOURCE_SINKS_H__
+#define __SOURCE_SINKS_H__
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/OwningPtr.h"
+#include <vector>
+
+using namespace llvm;
+
+typedef enum {
+	crInput = 0, crCopy = 1, crOutput = 2, crAlloc = 3
+} callRole;
+
+/*
+ * Struct CallRole
+ *
+ * What a library function means to the analyses:
+ *     - crInput:  the arguments in args receive input (ret: so does the return value)
+ *     - crCopy:   the arguments in args are copied into argument dst
+ *     - crOutput: the function writes data out of the program
+ *     - crAlloc:  the function allocates memory
+ *
+ * varArgsFrom extends args with every argument from that index on.
+ */
+struct CallRole {
+	callRole role;
+	std::vector<unsigned> args;
+	unsigned varArgsFrom;
+	unsigned dst;
+	bool ret;
+
+	CallRole() :
+		role(crOutput), varArgsFrom(~0U), dst(0), ret(false) {
+	}
+
+	//The values of CI named by args and varArgsFrom (and CI itself if ret is set)
+	void getValues(CallInst* CI, std::vector<Value*> &values) const;
+};
+
+/*
+ * Class SourceSinks
+ *
+ * The catalog of input sources, copies, output sinks and allocators shared by
+ * InputDep, AddStore, flowTracking and OverflowSanitizer. It starts with the
+ * functions these passes have always known, and -sourceSinkSpec adds or
+ * overrides entries from a text file with one function per line:
+ *
+ *     <name> input <args>
+ *     <name> copy <src args> <dst arg>
+ *     <name> output
+ *     <name> alloc
+ *
+ * where <args> are argument indices, "N..." for every argument from N on, or
+ * "ret" for the return value. Lines starting with '#' are comments.
+ */
+class SourceSinks {
+	private:
+		StringMap<CallRole> roles;
+		DenseMap<const Function*, const CallRole*> cache;
+
+		SourceSinks();
+		bool parse(StringRef spec, StringRef fileName);
+
+	public:
+		static SourceSinks& get();
+
+		//Resolve the callees of M once; lookup(Function*) is read-only afterwards
+		void cacheFunctions(Module &M);
+
+		const CallRole* lookup(StringRef name) const;
+		const CallRole* lookup(const Function* F) const;
+		const CallRole* lookup(CallInst* CI) const; //NULL for indirect calls
+
+		bool is(CallInst* CI, callRole role) const;
+};
+
+#endif
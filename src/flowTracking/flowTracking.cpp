@@ -4,8 +4,13 @@
 
 using namespace llvm;
 
-std::vector<BasicBlock *> ProcessedBB;
+static cl::opt<bool> controlRegionNodes("controlRegionNodes",
+		cl::desc("Link each predicate to one node per fully gated basic block instead of to each gated instruction."),
+		cl::init(false));
 
+static cl::opt<bool> allPairsSweep("allPairsSweep",
+		cl::desc("Find the leaking (source, sink) pairs with one backward and one forward sweep, and extract subgraphs only for them."),
+		cl::init(true));
 
 //Receive a predicate and include it on predicate attribute
 Pred::Pred(Value *p) {
@@ -15,6 +20,7 @@ Pred::Pred(Value *p) {
 //Receive a instruction and include it on insts vector
 void Pred::addInst (Instruction *i) {
 	insts.push_back(i);
+	gated.insert(i);
 }
 
 //Receive a function pointer and include it on funcs vector
@@ -52,14 +58,7 @@ Function *Pred::getFunc(int i) {
 
 //Return true of *op instruction is gated (if it is stored on insts vector) for the predicate
 bool Pred::isGated (Instruction *op) {
-	unsigned int i;
-
-	for (i=0; i<insts.size(); i++) {
-		if (op == insts[i])
-			return true;
-	}
-
-	return false;
+	return gated.count(op);
 }
 
 
@@ -67,7 +66,7 @@ bool Pred::isGated (Instruction *op) {
 //Passes which are used by bSSA pass
 void bSSA::getAnalysisUsage(AnalysisUsage &AU) const {
 
-		AU.addRequired<PostDominatorTree>();
+		AU.addRequired<ControlDependence>();
 		AU.addRequired<moduleDepGraph>();
 
         // This pass will modifies the program, but not the CFG
@@ -93,9 +92,13 @@ bool bSSA::runOnModule(Module &M) {
 
 		for (Module::iterator Mit = M.begin(), Mend = M.end(); Mit != Mend; ++Mit) {
 			F = Mit;
+			if (F->isDeclaration())
+				continue;
+			//Control dependences of F, computed once for all its predicates
+			ControlDependence &CD = getAnalysis<ControlDependence>(*F);
 			// Iterate over all Basic Blocks of the Function
 			for (Function::iterator Fit = F->begin(), Fend = F->end(); Fit != Fend; ++Fit) {
-				makeTable(Fit, F); //Creating in memory the table with predicates and gated instructions
+				makeTable(Fit, CD); //Creating in memory the table with predicates and gated instructions
 			}
 			
 		}
@@ -108,6 +111,8 @@ bool bSSA::runOnModule(Module &M) {
 		MDNode *N;
 
 		//Interates on all source code in order to get the sources of address (secret information) and sinks (instructions like printf)
+		SourceSinks &catalog = SourceSinks::get();
+		catalog.cacheFunctions(M);
 		for (Module::iterator F = M.begin(), eM = M.end(); F != eM; ++F) {
 				for (Function::iterator BB = F->begin(), e = F->end(); BB != e; ++BB) {
 					for (BasicBlock::iterator I = BB->begin(), ee = BB->end(); I != ee; ++I) {
@@ -137,90 +142,19 @@ bool bSSA::runOnModule(Module &M) {
 
 						//If is a function call
 						if (CallInst *CI = dyn_cast<CallInst>(I)) {
-							Function *Callee = CI->getCalledFunction();
-							if (Callee) {
-								StringRef Name = Callee->getName();
-								//if is a print function
-								if (Name.equals("printf")) {
-									dst.push_back(I);
-									dstLine.push_back(Line);
-									dstFileName.push_back(File);
-								}else if (Name.equals("fiprintf")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("fprintf")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("iprintf")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("vfprintf")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("vprintf")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("fputc")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("fputs")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("putc")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("putchar")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("puts")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("fwrite")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("pwrite")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}else if (Name.equals("write")) {
-									  dst.push_back(I);
-									  dstLine.push_back(Line);
-									  dstFileName.push_back(File);
-								}
-
-								//If is a source of address
-								if (Name.equals("malloc")) {
-									src.push_back(I);
-									srcLine.push_back(Line);
-									srcFileName.push_back(File);
-								}else if (Name.equals("calloc")) {
-									  src.push_back(I);
-									  srcLine.push_back(Line);
-									  srcFileName.push_back(File);
-								}else if (Name.equals("realloc")) {
-									  src.push_back(I);
-									  srcLine.push_back(Line);
-									  srcFileName.push_back(File);
-								}else if (Name.equals("realloccf")) {
-									  src.push_back(I);
-									  srcLine.push_back(Line);
-									  srcFileName.push_back(File);
-								}if (Name.equals("valloc")) {
-									  src.push_back(I);
-									  srcLine.push_back(Line);
-									  srcFileName.push_back(File);
-								}
+							const CallRole* role = catalog.lookup(CI);
+							//if is a print function
+							if (role && role->role == crOutput) {
+								dst.push_back(I);
+								dstLine.push_back(Line);
+								dstFileName.push_back(File);
+							}
+
+							//If is a source of address
+							if (role && role->role == crAlloc) {
+								src.push_back(I);
+								srcLine.push_back(Line);
+								srcFileName.push_back(File);
 							}
 						}
 					}
@@ -234,10 +168,17 @@ bool bSSA::runOnModule(Module &M) {
 
 		unsigned int countWarning=0;
 
+		//Sinks reached by each source, when the sweep is used
+		std::vector<BitVector> leaks;
+		if (allPairsSweep)
+			findLeaks(g, src, dst, leaks);
+
 		//Search leaks for each (source, sink). If there is a leak, include the tainted subgraph into set of tainted subgraphs.
 		int c=0;
 		for (unsigned int i=0; i<src.size(); i++) {
 			for (unsigned int j=0; j<dst.size(); j++) {
+				if (allPairsSweep && !leaks[i].test(j))
+					continue;
 				Graph subG = g->generateSubGraph(src[i], dst[j]);
 				Graph::iterator gIt = subG.begin(); 
 				Graph::iterator gIte = subG.end();
@@ -273,100 +214,192 @@ bool bSSA::runOnModule(Module &M) {
 //Increase graph including control edges
 void bSSA::incGraph (Graph *g) {
 	unsigned int i;
-    int j;
-
-
+	int j, k;
 
 	//For all predicates in predicatesVector
 	for (i=0; i<predicatesVector.size(); i++) {
 		//Locates the predicate (icmp instrution) Localiza o predicado (instrução icmp) from the graph
 		GraphNode *predNode = g->findNode(predicatesVector[i]->getPred());
+		if (predNode == NULL)
+			continue;
 
 		//For each predicate, iterates on the list of gated INSTRUCTIONS
-		for (j=0; j<predicatesVector[i]->getNumInstrucoes(); j++) {
-			GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(j));
-			if (predNode != NULL && instNode != NULL) {//If the instruction is on the graph, make a edge
-				g->addEdge(predNode, instNode, etControl);
+		for (j=0; j<predicatesVector[i]->getNumInstrucoes(); j = k) {
+			Instruction *inst = predicatesVector[i]->getInst(j);
+			BasicBlock *BB = inst->getParent();
+
+			//Gated instructions come a block at a time; k ends the run of BB
+			for (k = j + 1; k < predicatesVector[i]->getNumInstrucoes() && predicatesVector[i]->getInst(k)->getParent() == BB; k++)
+				;
+
+			//The whole block is gated: one edge to its region node
+			if (controlRegionNodes && inst == &BB->front() && (size_t)(k - j) == BB->size()) {
+				g->addEdge(predNode, getRegionNode(g, BB), etControl);
+				continue;
 			}
-		}
 
+			for (int l = j; l < k; l++) {
+				GraphNode *instNode = g->findNode(predicatesVector[i]->getInst(l));
+				if (instNode != NULL) //If the instruction is on the graph, make a edge
+					g->addEdge(predNode, instNode, etControl);
+			}
+		}
 
-		//For each predicate, iterates on the list of gated FUNCTIONS
+		//For each predicate, iterates on the list of gated FUNCTIONS: one edge to the entry gate of each
 		for (j=0; j<predicatesVector[i]->getNumFunctions(); j++) {
 			Function *F = predicatesVector[i]->getFunc(j);
-			//For each function, iterates on its basic blocks
-			for (Function::iterator Fit = F->begin(), Fend = F->end(); Fit != Fend; ++Fit) {
-				//For each basic block, iterates on its instructions
-				for (BasicBlock::iterator bBIt = Fit->begin(), bBEnd = Fit->end(); bBIt != bBEnd; ++bBIt) {
-					GraphNode *instNode = g->findNode(bBIt);
-					if (predNode != NULL && instNode != NULL)
-						g->addEdge(predNode, instNode, etControl);
-				}
-			}
+			g->addEdge(predNode, g->addJoin(F), etControl);
 		}
 
 	}
 
+}
 
+//Returns the node that stands for every instruction of BB in the control edges, creating it on first use
+GraphNode *bSSA::getRegionNode (Graph *g, BasicBlock *BB) {
+	DenseMap<BasicBlock *, GraphNode *>::iterator it = regionNodes.find(BB);
+	if (it != regionNodes.end())
+		return it->second;
+
+	GraphNode *regionNode = new OpNode(Instruction::Br);
+	regionNodes[BB] = regionNode;
+	for (BasicBlock::iterator bBIt = BB->begin(), bBEnd = BB->end(); bBIt != bBEnd; ++bBIt) {
+		GraphNode *instNode = g->findNode(bBIt);
+		if (instNode != NULL)
+			g->addEdge(regionNode, instNode, etControl);
+	}
+	return regionNode;
 }
 
 
 
 
+/*
+ * Sets leaks[i][j] when source src[i] reaches sink dst[j], the pairs for which
+ * generateSubGraph finds a subgraph. A backward sweep from all sinks keeps the
+ * nodes that reach some sink; a forward sweep from all sources then labels
+ * those nodes with the IDs (indices) of the sources that reach them.
+ */
+void bSSA::findLeaks (Graph *g, std::vector<Value *> &src, std::vector<Value *> &dst, std::vector<BitVector> &leaks) {
+	std::vector<GraphNode *> worklist;
+	DenseMap<GraphNode *, BitVector> labels;
+	SmallPtrSet<GraphNode *, 64> reachesSink, queued;
+
+	leaks.assign(src.size(), BitVector(dst.size()));
+
+	//Backward sweep from all sinks
+	for (unsigned int j=0; j<dst.size(); j++) {
+		GraphNode *sink = g->findNode(dst[j]);
+		if (sink != NULL && reachesSink.insert(sink))
+			worklist.push_back(sink);
+	}
+	while (!worklist.empty()) {
+		GraphNode *u = worklist.back();
+		worklist.pop_back();
+		std::map<GraphNode *, edgeType> preds = u->getPredecessors();
+		for (std::map<GraphNode *, edgeType>::iterator it = preds.begin(), e = preds.end(); it != e; ++it) {
+			if (reachesSink.insert(it->first))
+				worklist.push_back(it->first);
+		}
+	}
+
+	//Forward sweep from all sources, over the nodes that reach a sink
+	for (unsigned int i=0; i<src.size(); i++) {
+		GraphNode *source = g->findOpNode(src[i]);
+		if (source == NULL)
+			source = g->findNode(src[i]);
+		if (source == NULL || !reachesSink.count(source))
+			continue;
+		BitVector &label = labels[source];
+		label.resize(src.size());
+		label.set(i);
+		if (queued.insert(source))
+			worklist.push_back(source);
+	}
+	while (!worklist.empty()) {
+		GraphNode *u = worklist.back();
+		worklist.pop_back();
+		queued.erase(u);
+		BitVector label = labels[u];
+		std::map<GraphNode *, edgeType> succs = u->getSuccessors();
+		for (std::map<GraphNode *, edgeType>::iterator it = succs.begin(), e = succs.end(); it != e; ++it) {
+			if (!reachesSink.count(it->first))
+				continue;
+			BitVector &succLabel = labels[it->first];
+			succLabel.resize(src.size());
+			BitVector merged = succLabel;
+			merged |= label;
+			if (merged == succLabel)
+				continue;
+			succLabel = merged;
+			if (queued.insert(it->first))
+				worklist.push_back(it->first);
+		}
+	}
+
+	//The labels of each sink are the sources that reach it
+	for (unsigned int j=0; j<dst.size(); j++) {
+		GraphNode *sink = g->findNode(dst[j]);
+		if (sink == NULL || !labels.count(sink))
+			continue;
+		BitVector &label = labels[sink];
+		for (int i = label.find_first(); i != -1; i = label.find_next(i))
+			leaks[i].set(j);
+	}
+}
+
 //It receives a BasicBLock and makes table of predicates and its respective gated instructions
-void bSSA::makeTable (BasicBlock *BB, Function *F) {
+void bSSA::makeTable (BasicBlock *BB, ControlDependence &CD) {
 	    Value *condition;
   		TerminatorInst *ti = BB->getTerminator();
         BranchInst *bi = NULL;
         SwitchInst *si=NULL;
 
-        PostDominatorTree &PD = getAnalysis<PostDominatorTree>(*F);
-
-        ProcessedBB.clear();
         if ((bi = dyn_cast<BranchInst>(ti)) && bi->isConditional()) { //If the terminator instruction is a conditional branch
             condition = bi->getCondition();
             //Including the predicate on the predicatesVector
             predicatesVector.push_back(new Pred(condition));
-            //Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-            for (unsigned int i=0; i<bi->getNumSuccessors(); i++) {
-                 findIR (BB, bi->getSuccessor(i),PD);
-            }
+            //Gate the instructions on Influence Region of the predicate
+            gateRegion (BB, CD);
         }else if ((si = dyn_cast<SwitchInst>(ti))) {
         	condition = si->getCondition();
 		    //Including the predicate on the predicatesVector
 		    predicatesVector.push_back(new Pred(condition));
-		    //Make a "Flooding" on each sucessor gated the instruction on Influence Region of the predicate
-		    for (unsigned int i=0; i<si->getNumSuccessors(); i++) {
-		        findIR (BB, si->getSuccessor(i),PD);
-		    }
+		    //Gate the instructions on Influence Region of the predicate
+		    gateRegion (BB, CD);
         }
 }
 
 
-//Flooding until reach a posdominator node
-void bSSA::findIR (BasicBlock *bBOring, BasicBlock *bBSuss, PostDominatorTree &PD) {
+//Gates the influence region of the branch that ends BB with the last predicate
+void bSSA::gateRegion (BasicBlock *BB, ControlDependence &CD) {
 
-	Pred *p;
-	TerminatorInst *ti = bBSuss->getTerminator();
+	Pred *p = predicatesVector.back();
+	std::vector<BasicBlock *> region, exits;
+	CD.getInfluenceRegion(BB, region, exits);
 
+	//Instruction will be gated whit the BB predicate
+	for (std::vector<BasicBlock *>::iterator it = region.begin(), e = region.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end(); bBIt != bBEnd; ++bBIt) {
+			//If is a function call which is defined on the same module
+			if (CallInst *CI = dyn_cast<CallInst>(&(*bBIt))) {
+				Function *F = CI->getCalledFunction();
+				if (F != NULL)
+					if (!F->isDeclaration() && !F->isIntrinsic()) {
+						gateFunction (F, p);
+					}
+			}
 
-	//If the basic block has been processed, do not advance
-	for (unsigned int x=0; x<ProcessedBB.size(); x++) {
-		if (ProcessedBB[x] == bBSuss) {
-			return;
+			//Gate the other instructions
+			p->addInst(bBIt);
 		}
 	}
 
-	//Including the basic block in the processed vector
-	ProcessedBB.push_back(bBSuss);
-
-	//If the basic block is a posdominator and is not the start basic block, just gate the PHI instructions
-	if (PD.dominates(bBSuss, bBOring) && bBSuss != bBOring) {
-		//Find PHI instructions
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end(); bBIt != bBEnd; ++bBIt) {
+	//The exits post-dominate BB: just gate the PHI instructions
+	for (std::vector<BasicBlock *>::iterator it = exits.begin(), e = exits.end(); it != e; ++it) {
+		for (BasicBlock::iterator bBIt = (*it)->begin(), bBEnd = (*it)->end(); bBIt != bBEnd; ++bBIt) {
 			if (dyn_cast<Instruction>(bBIt)->getOpcode()==Instruction::PHI) {
 				//if there is a PHI's argument gated, gate the PHI instruction
-				p = predicatesVector.back();
 				for (unsigned int k=0; k<dyn_cast<Instruction>(bBIt)->getNumOperands(); k++) {
 					if (p->isGated(dyn_cast<Instruction>(dyn_cast<Instruction>(bBIt)->getOperand(k)))) {
 						p->addInst(bBIt);
@@ -375,30 +408,7 @@ void bSSA::findIR (BasicBlock *bBOring, BasicBlock *bBSuss, PostDominatorTree &P
 				}
 			}
 		}
-		return;
-	}else { //Advance the flooding
-		//Instruction will be gated whit the bBOring predicate
-		for (BasicBlock::iterator bBIt = bBSuss->begin(), bBEnd = bBSuss->end(); bBIt != bBEnd; ++bBIt) {
-			p = predicatesVector.back();
-
-			//If is a function call which is defined on the same module
-			if (CallInst *CI = dyn_cast<CallInst>(&(*bBIt))) {
-				Function *F = CI->getCalledFunction();
-				if (F != NULL)
-					if (!F->isDeclaration() && !F->isIntrinsic()) {
-						gateFunction (F, p);
-					}
-			}
-
-			//Gate the other instructions
-			p->addInst(bBIt);
-		}
-		//If there is successor, go there
-		for (unsigned int i=0; i<ti->getNumSuccessors(); i++) {
-			findIR (bBOring, ti->getSuccessor(i), PD);
-		}
 	}
-
 }
 
 //All instrutions of function F are gated with predicate p
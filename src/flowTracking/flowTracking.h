@@ -18,8 +18,11 @@
 #include <vector>
 #include <string>
 #include "../DepGraph/DepGraph.h"
+#include "SourceSinks.h"
+#include "ControlDependence.h"
 #include <sstream>
 #include "llvm/DebugInfo.h"
+#include "llvm/ADT/BitVector.h"
 
 #ifndef DEBUG_TYPE
 #define DEBUG_TYPE "bSSA"
@@ -32,6 +35,7 @@ namespace llvm {
 	class Pred {
 		Value *predicate;
 		std::vector<Instruction *> insts;
+		SmallPtrSet<Instruction *, 32> gated;	//Same instructions as insts, for isGated
 		std::vector<Function *> funcs;
 
 	public:
@@ -58,9 +62,12 @@ namespace llvm {
         	void incGraph (Graph *g); //Increase graph including control edges
 	private:
         	std::vector<Pred *> predicatesVector;	//Vector of predicates objects
-        	void makeTable (BasicBlock *b, Function *F);
-        	void findIR (BasicBlock *borigin, BasicBlock *bdst, PostDominatorTree &PD);	//Run on Influence Region of basic block borigin gated all instructions
+        	void makeTable (BasicBlock *b, ControlDependence &CD);
+        	void gateRegion (BasicBlock *BB, ControlDependence &CD);	//Gate all instructions on the Influence Region of the branch that ends BB
         	void gateFunction (Function *F, Pred *p);
+        	DenseMap<BasicBlock *, GraphNode *> regionNodes;	//Control region node of each basic block
+        	GraphNode *getRegionNode (Graph *g, BasicBlock *BB);
+        	void findLeaks (Graph *g, std::vector<Value *> &src, std::vector<Value *> &dst, std::vector<BitVector> &leaks);	//Which sinks each source reaches, in one sweep each way
 	};
 
 
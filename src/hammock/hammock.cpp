@@ -6,7 +6,7 @@ using namespace llvm;
 
 
 void hammock::getAnalysisUsage(AnalysisUsage &AU) const {
-		AU.addRequired<PostDominatorTree>();
+		AU.addRequired<ControlDependence>();
         // This pass will not modifies the program nor CFG
         AU.setPreservesAll();
 
@@ -17,12 +17,12 @@ bool hammock::runOnFunction(Function &F) {
 
 		functionIsHammock = true;
 
-		PostDominatorTree &PD = getAnalysis<PostDominatorTree>();
+		ControlDependence &CD = getAnalysis<ControlDependence>();
 		for (Function::iterator Fit = F.begin(), Fend = F.end(); Fit != Fend; ++Fit) {
 			//Mark BasicBlock
 			bBlocks.insert(Fit);
 			//Find Influence Region of the BasicBlock
-			processNode(Fit, PD);
+			processNode(Fit, CD);
 			//Check if some unmarked basic block goes to influence region
 			if (checkHammock(F)) {
 					++numHammock;
@@ -64,49 +64,21 @@ bool hammock::checkHammock (Function &F) {
 	return true;
 }
 
-//Start findIR method
-void hammock::processNode (BasicBlock *BB,  PostDominatorTree &PD ) {
+//Mark the Influence Region of BB and the blocks where it ends
+void hammock::processNode (BasicBlock *BB, ControlDependence &CD) {
 
   		TerminatorInst *ti = BB->getTerminator();
         BranchInst *bi = NULL;
-        SwitchInst *si=NULL;
+        std::vector<BasicBlock *> region, exits;
 
-
-        if ((bi = dyn_cast<BranchInst>(ti)) && bi->isConditional()) { //If the terminator instruction is a conditional branch
-            for (unsigned int i=0; i<bi->getNumSuccessors(); i++) {
-                 findIR (BB, bi->getSuccessor(i),PD);
-            }
-        }else if ((si = dyn_cast<SwitchInst>(ti))) {
-		    for (unsigned int i=0; i<si->getNumSuccessors(); i++) {
-		        findIR (BB, si->getSuccessor(i),PD);
-		    }
+        //If the terminator instruction is a conditional branch or a switch
+        if (((bi = dyn_cast<BranchInst>(ti)) && bi->isConditional()) || isa<SwitchInst>(ti)) {
+        	CD.getInfluenceRegion(BB, region, exits);
+        	bBlocks.insert(region.begin(), region.end());
+        	bBlocks.insert(exits.begin(), exits.end());
         }
 }
 
-void hammock::findIR (BasicBlock *bBOring, BasicBlock *bBSuss, PostDominatorTree &PD) {
-
-	TerminatorInst *ti = bBSuss->getTerminator();
-
-
-	if (bBlocks.count(bBSuss)>0) {
-		return;
-	}
-
-	//Mark BasicBlock
-	bBlocks.insert(bBSuss);
-
-	//If the basic block is a posdominator and is not the start basic block, just return
-	if (PD.dominates(bBSuss, bBOring) && bBSuss != bBOring) {
-		return;
-	}else { //Advance the flooding
-		//If there is successor, go there
-		for (unsigned int i=0; i<ti->getNumSuccessors(); i++) {
-			findIR (bBOring, ti->getSuccessor(i), PD);
-		}
-	}
-
-}
-
 char hammock::ID = 0;
 static RegisterPass<hammock> X("hammock", "hammock verify");
 
@@ -0,0 +1,216 @@
+#! /usr/bin/env bash
+#
+# Runs the range analyses over the tests in this directory.
+#
+#   run_tests.sh [-o results] [-s copies] [test.txt ...]
+#
+# Each test (a C file named .txt, by default every test in sra/, reg/, tfa/
+# and dg/) is compiled to bitcode and put in SSA form. The symbolic range
+# analysis (-sra) output is compared with the .sym file next to the test;
+# both are sorted first, because the pass prints the ranges in hash order.
+# The integer range analysis (-ra-inter-cousot) has no expected output and is
+# only timed. The tests in tfa/ run the tainted flow analysis (-tfa) instead,
+# with and without -tfaDemand, and compare the tainted instructions with the
+# .taint file next to the test. The tests in dg/ build the module dependence
+# graph with -depGraphSummaries and compare its summary edges with the
+# .summary file next to the test.
+#
+# One line per test and pass goes to the results file (results.tsv):
+#
+#   <test> <pass> <ok|fail|crash> <wall seconds> <peak RSS in KB>
+#
+# so that the results of two builds can be compared.
+#
+# With -s N the tests are not checked. Instead, each test is replicated N
+# times (main renamed and every function made internal in each copy), all
+# the copies are linked into one module, and the passes are timed over it.
+#
+# The tools can be changed with CLANG, OPT, LLVM_LINK and GNU_TIME, the
+# libraries with GA_LIB (GreenArrays, which needs LD_PRELOAD of GiNaC with
+# an in-tree build) and ARANOT_LIB, and extra flags for the passes given
+# with SRA_FLAGS and RA_FLAGS (e.g. RA_FLAGS="-raThreads=4"). The tests in
+# tfa/ and dg/ are not replicated by -s.
+
+CLANG=${CLANG:-clang}
+OPT=${OPT:-opt}
+LLVM_LINK=${LLVM_LINK:-llvm-link}
+GNU_TIME=${GNU_TIME:-/usr/bin/time}
+GA_LIB=${GA_LIB:-GreenArrays.so}
+ARANOT_LIB=${ARANOT_LIB:-ArAnot.so}
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+RESULTS=results.tsv
+COPIES=0
+
+usage() {
+  echo "usage: $0 [-o results] [-s copies] [test.txt ...]"
+}
+
+while getopts "o:s:h" option; do
+  case $option in
+    o) RESULTS=$OPTARG ;;
+    s) COPIES=$OPTARG ;;
+    *) usage; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+TESTS=("$@")
+if [[ ${#TESTS[@]} == 0 ]]; then
+  TESTS=("$DIR"/sra/*.txt "$DIR"/reg/*.txt)
+  [[ $COPIES == 0 ]] && TESTS+=("$DIR"/tfa/*.txt "$DIR"/dg/*.txt)
+fi
+
+TMP=`mktemp -d`
+trap 'rm -rf "$TMP"' EXIT
+
+: > "$RESULTS"
+FAILED=0
+
+# compile <source> <bitcode> [clang flags]
+compile() {
+  local src=$1 out=$2
+  shift 2
+  "$CLANG" -x c -c -emit-llvm -O0 "$@" "$src" -o "$TMP/raw.bc" &&
+    "$OPT" -mem2reg -instnamer "$TMP/raw.bc" -o "$out"
+}
+
+# measure <log> <command...>: runs the command and sets SECS and RSS
+measure() {
+  local log=$1
+  shift
+  "$GNU_TIME" -f "%e %M" -o "$TMP/time" "$@" > "$log" 2>&1
+  local status=$?
+  read SECS RSS < <(tail -n 1 "$TMP/time")
+  return $status
+}
+
+# record <test> <pass> <status>
+record() {
+  printf "%s\t%s\t%s\t%s\t%s\n" "$1" "$2" "$3" "$SECS" "$RSS" >> "$RESULTS"
+  if [[ "$3" != "ok" ]]; then
+    FAILED=$((FAILED + 1))
+  fi
+  printf "%-24s %-16s %-6s %8ss %10sKB\n" "$1" "$2" "$3" "$SECS" "$RSS"
+}
+
+# run_passes <name> <bitcode> [expected ranges]
+run_passes() {
+  local name=$1 bc=$2 sym=$3
+
+  if measure "$TMP/sra.log" "$OPT" -load "$GA_LIB" -redef -sra -analyze \
+      $SRA_FLAGS "$bc"; then
+    status=ok
+    if [[ -n "$sym" ]]; then
+      sed -n '/=== RANGES ===/,$p' "$TMP/sra.log" | grep ' = ' | sort \
+        > "$TMP/got"
+      sort "$sym" > "$TMP/expected"
+      if ! diff -u "$TMP/expected" "$TMP/got" > "$TMP/diff"; then
+        status=fail
+      fi
+    fi
+  else
+    status=crash
+  fi
+  record "$name" sra $status
+  [[ $status == fail ]] && cat "$TMP/diff"
+  [[ $status == crash ]] && tail -n 20 "$TMP/sra.log"
+
+  if measure "$TMP/ra.log" "$OPT" -load "$ARANOT_LIB" -ra-inter-cousot \
+      $RA_FLAGS -disable-output "$bc"; then
+    status=ok
+  else
+    status=crash
+  fi
+  record "$name" ra-inter-cousot $status
+  [[ $status == crash ]] && tail -n 20 "$TMP/ra.log"
+}
+
+# run_taint <name> <bitcode> <expected tainted instructions>
+run_taint() {
+  local name=$1 bc=$2 taint=$3 mode
+
+  for mode in tfa tfa-demand; do
+    local flags=
+    [[ $mode == tfa-demand ]] && flags=-tfaDemand
+    if measure "$TMP/tfa.log" "$OPT" -load "$GA_LIB" -tfa $flags -analyze \
+        "$bc"; then
+      status=ok
+      sed -n "/Printing analysis 'Tainted Flow Analysis'/,\$p" "$TMP/tfa.log" |
+        grep ': ' | sort > "$TMP/got"
+      sort "$taint" > "$TMP/expected"
+      if ! diff -u "$TMP/expected" "$TMP/got" > "$TMP/diff"; then
+        status=fail
+      fi
+    else
+      status=crash
+    fi
+    record "$name" $mode $status
+    [[ $status == fail ]] && cat "$TMP/diff"
+    [[ $status == crash ]] && tail -n 20 "$TMP/tfa.log"
+  done
+}
+
+# run_summaries <name> <bitcode> <expected summary edges>
+run_summaries() {
+  local name=$1 bc=$2 summary=$3
+
+  if measure "$TMP/dg.log" "$OPT" -load "$GA_LIB" -moduleDepGraph \
+      -depGraphSummaries -analyze "$bc"; then
+    status=ok
+    sed -n "/Printing analysis 'Module Dependence Graph'/,\$p" "$TMP/dg.log" |
+      grep ' <- ' | sort > "$TMP/got"
+    sort "$summary" > "$TMP/expected"
+    if ! diff -u "$TMP/expected" "$TMP/got" > "$TMP/diff"; then
+      status=fail
+    fi
+  else
+    status=crash
+  fi
+  record "$name" summaries $status
+  [[ $status == fail ]] && cat "$TMP/diff"
+  [[ $status == crash ]] && tail -n 20 "$TMP/dg.log"
+}
+
+if [[ $COPIES == 0 ]]; then
+  for test in "${TESTS[@]}"; do
+    name=$(basename "$(dirname "$test")")/$(basename "$test" .txt)
+    if ! compile "$test" "$TMP/test.bc"; then
+      SECS=0 RSS=0 record "$name" compile crash
+      continue
+    fi
+    if [[ -f "${test%.txt}.taint" ]]; then
+      run_taint "$name" "$TMP/test.bc" "${test%.txt}.taint"
+    elif [[ -f "${test%.txt}.summary" ]]; then
+      run_summaries "$name" "$TMP/test.bc" "${test%.txt}.summary"
+    else
+      run_passes "$name" "$TMP/test.bc" "${test%.txt}.sym"
+    fi
+  done
+else
+  # Every copy gets its own main and internal functions, so that the copies
+  # do not clash when linked
+  copies=()
+  for ((i = 0; i < COPIES; i++)); do
+    n=0
+    for test in "${TESTS[@]}"; do
+      bc="$TMP/copy.$i.$n.bc"
+      if compile "$test" "$TMP/named.bc" -Dmain=main_${i}_$n &&
+          "$OPT" -internalize "$TMP/named.bc" -o "$bc"; then
+        copies+=("$bc")
+      else
+        echo "$test: could not be compiled"
+      fi
+      n=$((n + 1))
+    done
+  done
+
+  if ! "$LLVM_LINK" "${copies[@]}" -o "$TMP/scaled.bc"; then
+    echo "The copies could not be linked"
+    exit 1
+  fi
+  run_passes "scaled-x$COPIES" "$TMP/scaled.bc"
+fi
+
+echo "$FAILED failures, results in $RESULTS"
+[[ $FAILED == 0 ]]